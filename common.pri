@@ -7,6 +7,18 @@ msvc:QMAKE_CXXFLAGS_WARN_ON += -wd4100
 # deprecated API in order to know how to port your code away from it.
 DEFINES += QT_DEPRECATED_WARNINGS
 
+# Per-opcode decoder instrumentation (see src/parser/SC3DecodeStats.h).
+# Off by default, enable with: qmake CONFIG+=decode_stats
+decode_stats:DEFINES += SC3_DECODE_STATS
+
+# zlib, for compressed MPK entries. On Windows point ZLIB_DIR at a zlib build.
+win32 {
+    INCLUDEPATH += $$(ZLIB_DIR)/include
+    LIBS += -L$$(ZLIB_DIR)/lib -lzlib
+} else {
+    LIBS += -lz
+}
+
 # This crap lets us run files with the same name, in the same project, through moc, without conflicts.
 # Good idea? Probably not.
 
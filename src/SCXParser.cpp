@@ -1,18 +1,27 @@
 // SCXParser.cpp : Defines the entry point for the console application.
 //
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
 #include "parser/SC3Argument.h"
+#include "parser/MPKArchive.h"
 #include "parser/CCDisassembler.h"
 #include "parser/SC3StringDecoder.h"
 #include "parser/CCCharset.h"
 #include "parser/SCXFile.h"
 #include "parser/SC3CodeBlock.h"
+#include "parser/SC3DecodeStats.h"
+#include "parser/SC3InstructionSearch.h"
+#include "parser/SC3ScriptDiff.h"
 
 std::string uint8_vector_to_hex_string(const std::vector<uint8_t> &v) {
   std::stringstream ss;
@@ -98,60 +107,221 @@ std::string GetFirstSC3String(const std::vector<std::string> &stringTable,
   return "";
 }
 
-int main() {
-  std::vector<std::pair<uint8_t *, std::streamsize>> files;
+std::string SC3InstructionToString(const SC3Instruction *inst) {
+  if (inst->name() == "Assign") return SC3ArgumentToString(inst->args().at(0));
+  std::string result = inst->name();
+  int i = 0;
+  int argCount = inst->args().size();
+  if (argCount > 0) {
+    result += "(";
+    for (const auto &arg : inst->args()) {
+      i++;
+      result += arg.name + ": " + SC3ArgumentToString(arg);
+      if (i < argCount) result += ", ";
+    }
+    result += ")";
+  }
+  return result;
+}
 
-  std::string path = "G:\\Games\\SGTL\\CCEnVitaPatch101\\script_dis";
+// scx must be disassembled already
+void DumpSCXFile(SCXFile &scx, const std::string &outPath) {
+  SC3StringDecoder strdec(scx, CCCharset);
+  const std::vector<std::string> stringTable = strdec.decodeStringTableToUtf8();
 
-  int fileId = 0;
-  for (auto &p : std::experimental::filesystem::directory_iterator(path)) {
-    if (p.path().extension().string() != ".scx") continue;
+  std::ofstream outFile(outPath,
+                        std::ios::out | std::ios::trunc | std::ios::binary);
+  int i = 0;
+  for (const auto &label : scx.disassembly()) {
+    outFile << "\n#label" << i << "_" << label->address() << ":\n";
+    i++;
+    for (const auto &inst : label->instructions()) {
+      outFile << "\t" << SC3InstructionToString(inst.get());
+      if (inst->name() != "Assign" && inst->args().size() > 0)
+        outFile << GetFirstSC3String(stringTable, inst.get());
+      outFile << "\n";
+    }
+  }
+  outFile.close();
+}
 
-    std::ifstream file(p.path(), std::ios::binary | std::ios::ate);
-    std::streamsize size = file.tellg();
-    uint8_t *buf = (uint8_t *)malloc(size);
-    file.seekg(0, std::ios::beg);
-    file.read((char *)buf, size);
-    file.close();
+struct LoadedScript {
+  std::unique_ptr<SCXFile> scx;
+  // where a dump of it goes
+  std::string outPath;
+};
 
-    std::string outPath = p.path().string() + ".txt";
-    SCXFile scx(buf, size, p.path().filename().string(), fileId++);
-    CCDisassembler dis(scx);
+// Loads and disassembles the .scx files in a directory, or the named scripts
+// (all if none) of an MPK archive. throws std::runtime_error
+std::vector<LoadedScript> LoadScripts(const std::string &path,
+                                      const std::vector<std::string> &names) {
+  std::vector<LoadedScript> scripts;
+  std::experimental::filesystem::path fsPath(path);
+  if (fsPath.extension().string() == ".mpk") {
+    MPKArchive mpk(path);
+    std::vector<size_t> selected;
+    for (const auto &name : names) {
+      int index = mpk.findEntry(name);
+      if (index < 0) {
+        std::cerr << "No such script in archive: " << name << "\n";
+        continue;
+      }
+      selected.push_back(index);
+    }
+    if (names.empty()) {
+      for (size_t i = 0; i < mpk.entries().size(); i++) selected.push_back(i);
+    }
+
+    // compressed entries get inflated in parallel
+    std::vector<uint8_t *> bufs = mpk.extractEntries(selected);
+    for (size_t i = 0; i < selected.size(); i++) {
+      const MPKEntry &entry = mpk.entries()[selected[i]];
+      if (bufs[i] == nullptr) {
+        std::cerr << "Couldn't extract script: " << entry.name << "\n";
+        continue;
+      }
+      LoadedScript script;
+      script.outPath = (fsPath.parent_path() / (entry.name + ".txt")).string();
+      script.scx.reset(new SCXFile(
+          bufs[i], (SCXOffset)entry.uncompressedSize, entry.name, entry.id));
+      scripts.push_back(std::move(script));
+    }
+  } else {
+    int fileId = 0;
+    for (auto &p : std::experimental::filesystem::directory_iterator(path)) {
+      if (p.path().extension().string() != ".scx") continue;
+
+      std::ifstream file(p.path(), std::ios::binary | std::ios::ate);
+      std::streamsize size = file.tellg();
+      uint8_t *buf = (uint8_t *)malloc(size);
+      file.seekg(0, std::ios::beg);
+      file.read((char *)buf, size);
+      file.close();
+
+      LoadedScript script;
+      script.outPath = p.path().string() + ".txt";
+      script.scx.reset(
+          new SCXFile(buf, size, p.path().filename().string(), fileId++));
+      scripts.push_back(std::move(script));
+    }
+  }
+
+  for (auto &script : scripts) {
+    CCDisassembler dis(*script.scx);
     dis.DisassembleFile();
-    SC3StringDecoder strdec(scx, CCCharset);
-    const std::vector<std::string> stringTable =
-        strdec.decodeStringTableToUtf8();
-
-    std::ofstream outFile(outPath,
-                          std::ios::out | std::ios::trunc | std::ios::binary);
-    int i = 0;
-    for (const auto &label : scx.disassembly()) {
-      outFile << "\n#label" << i << "_" << label->address() << ":\n";
-      i++;
-      for (const auto &inst : label->instructions()) {
-        if (inst->name() == "Assign") {
-          outFile << "\t" << SC3ArgumentToString(inst->args().at(0)) << "\n";
-          continue;
-        }
-        outFile << "\t" << inst->name();
-        int i = 0;
-        int argCount = inst->args().size();
-        if (argCount > 0) {
-          outFile << "(";
-          for (const auto &arg : inst->args()) {
-            i++;
-            outFile << arg.name << ": ";
-            outFile << SC3ArgumentToString(arg);
-            if (i < argCount) outFile << ", ";
+  }
+  return scripts;
+}
+
+void FindInstructions(const std::vector<LoadedScript> &scripts,
+                      const std::string &queryText) {
+  SC3InstructionQuery query = SC3InstructionQuery::parse(queryText);
+  std::vector<const SCXFile *> files;
+  for (const auto &script : scripts) files.push_back(script.scx.get());
+  SC3InstructionSearch search(files);
+  // search hits only carry file ids
+  std::map<int, const SCXFile *> filesById;
+  for (const SCXFile *file : files) filesById[file->getId()] = file;
+
+  for (const auto &hit : search.find(query)) {
+    std::cout << filesById[hit.fileId]->getName() << "@" << std::hex
+              << hit.inst->position() << std::dec << " (label" << hit.labelId
+              << ")\t" << SC3InstructionToString(hit.inst) << "\n";
+  }
+}
+
+static std::string LabelDiffHeader(const SCXFile *file, int labelId) {
+  return "label" + std::to_string(labelId) + "_" +
+         std::to_string(file->disassembly()[labelId]->address());
+}
+
+void DiffScripts(const std::vector<LoadedScript> &oldScripts,
+                 const std::vector<LoadedScript> &newScripts) {
+  std::vector<const SCXFile *> oldFiles, newFiles;
+  for (const auto &script : oldScripts) oldFiles.push_back(script.scx.get());
+  for (const auto &script : newScripts) newFiles.push_back(script.scx.get());
+
+  for (const auto &diff : DiffSCXFileSets(oldFiles, newFiles)) {
+    if (diff.identical()) continue;
+    if (diff.newFile == nullptr) {
+      std::cout << "--- " << diff.oldFile->getName() << " (removed)\n";
+      continue;
+    }
+    if (diff.oldFile == nullptr) {
+      std::cout << "+++ " << diff.newFile->getName() << " (added)\n";
+      continue;
+    }
+    std::cout << "=== " << diff.oldFile->getName() << "\n";
+    for (const auto &label : diff.labels) {
+      switch (label.kind) {
+        case SC3LabelDiff::Unchanged:
+          break;
+        case SC3LabelDiff::Removed:
+          std::cout << "- #" << LabelDiffHeader(diff.oldFile, label.oldLabelId)
+                    << "\n";
+          break;
+        case SC3LabelDiff::Added:
+          std::cout << "+ #" << LabelDiffHeader(diff.newFile, label.newLabelId)
+                    << "\n";
+          break;
+        case SC3LabelDiff::Changed:
+          std::cout << "@ #" << LabelDiffHeader(diff.oldFile, label.oldLabelId)
+                    << " -> #"
+                    << LabelDiffHeader(diff.newFile, label.newLabelId) << "\n";
+          for (const auto &op : label.ops) {
+            if (op.kind == SC3InstructionDiffOp::Removed)
+              std::cout << "-\t" << SC3InstructionToString(op.oldInst) << "\n";
+            else if (op.kind == SC3InstructionDiffOp::Added)
+              std::cout << "+\t" << SC3InstructionToString(op.newInst) << "\n";
           }
-          outFile << ")";
-          outFile << GetFirstSC3String(stringTable, inst.get());
-        }
-        outFile << "\n";
+          break;
       }
     }
-    outFile.close();
   }
+}
+
+// usage: scxparser <directory of .scx files>
+//        scxparser <archive.mpk> [script names...]
+//        scxparser --find <query> <directory or archive.mpk> [script names...]
+//        scxparser --diff <old dir or .mpk> <new dir or .mpk> [script names...]
+// Only the named scripts are extracted from an archive, or all if none are
+// given. Dumps go to <script path>.txt, next to the archive for MPKs. --find
+// prints matching instructions instead, see SC3InstructionQuery for the query
+// syntax. --diff prints the labels that changed between two versions of the
+// scripts, with the removed and added instructions of each.
+int main(int argc, char *argv[]) {
+  std::string path = "G:\\Games\\SGTL\\CCEnVitaPatch101\\script_dis";
+  std::string query;
+  std::string diffPath;
+  int arg = 1;
+  if (argc > 2 && std::string(argv[1]) == "--find") {
+    query = argv[2];
+    arg = 3;
+  } else if (argc > 3 && std::string(argv[1]) == "--diff") {
+    // path is the new version
+    diffPath = argv[2];
+    arg = 3;
+  }
+  if (argc > arg) path = argv[arg++];
+  std::vector<std::string> names(argv + std::min(arg, argc), argv + argc);
+
+  try {
+    std::vector<LoadedScript> scripts = LoadScripts(path, names);
+    if (!diffPath.empty()) {
+      DiffScripts(LoadScripts(diffPath, names), scripts);
+    } else if (!query.empty()) {
+      FindInstructions(scripts, query);
+    } else {
+      for (auto &script : scripts) DumpSCXFile(*script.scx, script.outPath);
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+#ifdef SC3_DECODE_STATS
+  std::cout << SC3DecodeStats::globalReport();
+#endif
 
 #if 0
 	int unrecognizedCount = 0;
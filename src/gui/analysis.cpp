@@ -1,54 +1,95 @@
 #include <algorithm>
+#include <map>
+#include <set>
 #include "analysis.h"
 
 int firstLabelForAddress(const SCXFile *file, SCXOffset address) {
   const auto &disasm = file->disassembly();
-  const auto labelCount = disasm.size();
+  if (disasm.empty()) return -1;
+  // first label at the address, else the last one before it
+  auto it = std::lower_bound(
+      disasm.begin(), disasm.end(), address,
+      [](const std::unique_ptr<SC3CodeBlock> &label, SCXOffset address) {
+        return label->address() < address;
+      });
+  if (it != disasm.end() && (*it)->address() == address)
+    return it - disasm.begin();
+  return std::max(0, (int)(it - disasm.begin()) - 1);
+}
+
+int labelForAddress(const SCXFile *file, SCXOffset address) {
+  int labelCount = file->getLabelCount();
   if (labelCount == 0) return -1;
-  int labelId = 0;
-  for (int i = 0; i < labelCount; i++) {
-    if (disasm[i]->address() == address) {
-      return i;
-    }
-    if (disasm[i]->address() < address) {
-      labelId = i;
-    }
-    if (disasm[i]->address() > address) {
-      break;
-    }
+  // label offsets are ascending
+  int lo = 0, hi = labelCount - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (file->getLabelOffset(mid) <= address)
+      lo = mid;
+    else
+      hi = mid - 1;
   }
-  return labelId;
+  return lo;
+}
+
+// index of the last instruction in [first, last) starting at or before address,
+// or first if there's none
+static uint32_t instBefore(const std::vector<SCXOffset> &offsets,
+                           uint32_t first, uint32_t last, SCXOffset address) {
+  auto it = std::upper_bound(offsets.begin() + first, offsets.begin() + last,
+                             address);
+  uint32_t index = it - offsets.begin();
+  return index > first ? index - 1 : first;
 }
 
 std::pair<int, int> instIdAtAddress(const SCXFile *file, SCXOffset address) {
   int labelId = firstLabelForAddress(file, address);
-  int instId;
-  while (labelId < file->disassembly().size()) {
-    instId = instIdAtAddress(file, labelId, address);
-    if (instId >= 0) return std::make_pair(labelId, instId);
+  if (labelId < 0) return std::make_pair(-1, -1);
+  const auto &starts = file->labelInstructionStarts();
+  int labelCount = file->disassembly().size();
+  // empty labels have nothing at the address
+  while (labelId < labelCount && starts[labelId] == starts[labelId + 1])
     labelId++;
-  }
-  return std::make_pair(-1, -1);
+  if (labelId == labelCount) return std::make_pair(-1, -1);
+  return std::make_pair(labelId, instIdAtAddress(file, labelId, address));
 }
 
 int instIdAtAddress(const SCXFile *file, int labelId, SCXOffset address) {
-  if (labelId < 0 || labelId > file->disassembly().size()) return -1;
-  const auto &insts = file->disassembly()[labelId]->instructions();
-  const auto instCount = insts.size();
-  if (instCount == 0) return -1;
-  int instId = 0;
-  for (int i = 0; i < instCount; i++) {
-    if (insts[i]->position() == address) {
-      return i;
-    }
-    if (insts[i]->position() < address) {
-      instId = i;
-    }
-    if (insts[i]->position() > address) {
-      break;
-    }
+  if (labelId < 0 || labelId >= file->disassembly().size()) return -1;
+  const auto &starts = file->labelInstructionStarts();
+  uint32_t first = starts[labelId], last = starts[labelId + 1];
+  if (first == last) return -1;
+  return instBefore(file->instructionOffsets(), first, last, address) - first;
+}
+
+std::vector<std::pair<int, int>> instIdsAtAddresses(
+    const SCXFile *file, const std::vector<SCXOffset> &addresses) {
+  std::vector<std::pair<int, int>> result(addresses.size(),
+                                          std::make_pair(-1, -1));
+  std::vector<size_t> order(addresses.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return addresses[a] < addresses[b];
+  });
+
+  // in address order the answers only move forward, so each search starts
+  // where the last one ended
+  const auto &offsets = file->instructionOffsets();
+  const auto &starts = file->labelInstructionStarts();
+  if (offsets.empty()) return result;
+  size_t next = 0;
+  for (size_t i : order) {
+    next = std::upper_bound(offsets.begin() + next, offsets.end(),
+                            addresses[i]) -
+           offsets.begin();
+    uint32_t inst = next > 0 ? next - 1 : 0;
+    // last label starting at or before it, which skips empty labels
+    int labelId =
+        std::upper_bound(starts.begin(), starts.end() - 1, inst) -
+        starts.begin() - 1;
+    result[i] = std::make_pair(labelId, (int)(inst - starts[labelId]));
   }
-  return instId;
+  return result;
 }
 
 const SC3Instruction *instructionAtAddress(const SCXFile *file,
@@ -165,6 +206,15 @@ std::vector<int> localLabelRefsInExpression(const SC3Expression &expr) {
   return result;
 }
 
+std::vector<int> stringRefsInInstruction(const SC3Instruction *inst) {
+  std::vector<int> refs;
+  for (const auto &arg : inst->args()) {
+    if (arg.type == SC3ArgumentType::StringRef)
+      refs.push_back(arg.uint16_value);
+  }
+  return refs;
+}
+
 bool expressionIsConstant(const SC3Expression &expr) {
   return expr.simplified() == nullptr ||
          expr.simplified()->type == SC3ExpressionTokenType::ImmediateValue;
@@ -173,4 +223,71 @@ bool expressionIsConstant(const SC3Expression &expr) {
 int constantValueForExpression(const SC3Expression &expr) {
   if (expr.simplified() == nullptr) return 0;
   return expr.simplified()->value;
-}
\ No newline at end of file
+}
+
+std::vector<std::pair<int, int>> farLabelRefsInInstruction(
+    const SC3Instruction *inst) {
+  std::vector<std::pair<int, int>> refs;
+
+  for (const auto &arg : inst->args()) {
+    if (arg.type != SC3ArgumentType::FarLabel) continue;
+    int scriptBuffer = expressionIsConstant(arg.exprValue)
+                           ? constantValueForExpression(arg.exprValue)
+                           : -1;
+    refs.emplace_back(scriptBuffer, arg.uint16_value);
+  }
+
+  return refs;
+}
+
+std::pair<int, int> scriptLoadInInstruction(const SC3Instruction *inst) {
+  // called ScriptLoad or LoadScript depending on the game, but the arguments
+  // are the same
+  const SC3Expression *buffer = nullptr;
+  const SC3Expression *file = nullptr;
+  for (const auto &arg : inst->args()) {
+    if (arg.type != SC3ArgumentType::Expression) continue;
+    if (arg.name == "scriptBuffer") buffer = &arg.exprValue;
+    if (arg.name == "scriptFile") file = &arg.exprValue;
+  }
+  if (buffer == nullptr || file == nullptr || !expressionIsConstant(*buffer) ||
+      !expressionIsConstant(*file))
+    return std::make_pair(-1, -1);
+  return std::make_pair(constantValueForExpression(*buffer),
+                        constantValueForExpression(*file));
+}
+
+void resolveFarLabelRefs(std::vector<FarLabelRef> &refs,
+                         const std::vector<ScriptLoadRef> &loads) {
+  std::map<int, std::set<int>> filesByBuffer;
+  for (const auto &load : loads)
+    filesByBuffer[load.scriptBuffer].insert(load.targetFileId);
+
+  auto load = loads.begin();
+  int loadsFileId = -1;
+  // scriptBuffer -> fileId, as of the current ref
+  std::map<int, int> loaded;
+  for (auto &ref : refs) {
+    ref.targetFileId = -1;
+    if (ref.scriptBuffer < 0) continue;
+    if (ref.fileId != loadsFileId) {
+      loaded.clear();
+      loadsFileId = ref.fileId;
+      while (load != loads.end() && load->fileId < ref.fileId) load++;
+    }
+    while (load != loads.end() && load->fileId == ref.fileId &&
+           load->address < ref.address) {
+      loaded[load->scriptBuffer] = load->targetFileId;
+      load++;
+    }
+
+    auto inFile = loaded.find(ref.scriptBuffer);
+    if (inFile != loaded.end()) {
+      ref.targetFileId = inFile->second;
+      continue;
+    }
+    auto anywhere = filesByBuffer.find(ref.scriptBuffer);
+    if (anywhere != filesByBuffer.end() && anywhere->second.size() == 1)
+      ref.targetFileId = *anywhere->second.begin();
+  }
+}
@@ -12,11 +12,48 @@ struct VariableRef {
   int var;
 };
 
+// constant ScriptLoad(scriptBuffer, scriptFile)
+struct ScriptLoadRef {
+  int fileId;
+  SCXOffset address;
+  int scriptBuffer;
+  int targetFileId;
+};
+
+struct FarLabelRef {
+  int fileId;
+  SCXOffset address;
+  // -1 if not constant
+  int scriptBuffer;
+  int labelId;
+  // -1 until resolved
+  int targetFileId;
+  // CallGraph::Kind of the instruction, -1 if it isn't a call
+  int callKind;
+};
+
+// call edge within a script, see CallGraph
+struct LocalCallRef {
+  int fileId;
+  SCXOffset address;
+  // calling label
+  int fromLabelId;
+  int toLabelId;
+  int callKind;
+};
+
 int firstLabelForAddress(const SCXFile *file, SCXOffset address);
+// same, but only uses the label table, so works before disassembly
+int labelForAddress(const SCXFile *file, SCXOffset address);
 
+// Instruction at or before the address. All of these binary search the
+// file's instruction offsets.
 // this overload only searches the given label!
 int instIdAtAddress(const SCXFile *file, int labelId, SCXOffset address);
 std::pair<int, int> instIdAtAddress(const SCXFile *file, SCXOffset address);
+// instIdAtAddress for many addresses at once, in the same order
+std::vector<std::pair<int, int>> instIdsAtAddresses(
+    const SCXFile *file, const std::vector<SCXOffset> &addresses);
 const SC3Instruction *instructionAtAddress(const SCXFile *file,
                                            SCXOffset address);
 
@@ -32,5 +69,21 @@ std::vector<int> localLabelRefsAtAddress(const SCXFile *file,
                                          SCXOffset address);
 std::vector<int> localLabelRefsInExpression(const SC3Expression &expr);
 
+std::vector<int> stringRefsInInstruction(const SC3Instruction *inst);
+
 bool expressionIsConstant(const SC3Expression &expr);
-int constantValueForExpression(const SC3Expression &expr);
\ No newline at end of file
+int constantValueForExpression(const SC3Expression &expr);
+
+// (scriptBuffer, labelId), scriptBuffer is -1 if it isn't constant
+std::vector<std::pair<int, int>> farLabelRefsInInstruction(
+    const SC3Instruction *inst);
+// (scriptBuffer, fileId) for a ScriptLoad with constant arguments, (-1, -1)
+// for anything else
+std::pair<int, int> scriptLoadInInstruction(const SC3Instruction *inst);
+
+// Ties far label refs to the script loaded into their buffer: the last
+// ScriptLoad of that buffer before the ref in the same file, or else the only
+// script ever loaded into it anywhere. Both vectors must be sorted by
+// (fileId, address).
+void resolveFarLabelRefs(std::vector<FarLabelRef> &refs,
+                         const std::vector<ScriptLoadRef> &loads);
@@ -0,0 +1,86 @@
+#include "backgrounddisassembler.h"
+#include <parser/SC3BaseDisassembler.h>
+#include <parser/SCXFile.h>
+#include <parser/SupportedGame.h>
+
+BackgroundDisassembler::BackgroundDisassembler(
+    const SupportedGame* game, const std::vector<SCXFile*>& files,
+    const Analyzer& analyze, const Callback& onFileDone, int threadCount)
+    : _game(game), _analyze(analyze), _onFileDone(onFileDone) {
+  for (SCXFile* file : files) {
+    _jobIndices[file->getId()] = _jobs.size();
+    _jobs.push_back({file, JobState::Pending});
+  }
+
+  if (threadCount <= 0) threadCount = std::thread::hardware_concurrency();
+  if (threadCount <= 0) threadCount = 1;
+  if (threadCount > (int)_jobs.size()) threadCount = (int)_jobs.size();
+  for (int i = 0; i < threadCount; i++)
+    _threads.emplace_back(&BackgroundDisassembler::run, this);
+}
+
+BackgroundDisassembler::~BackgroundDisassembler() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  for (auto& thread : _threads) thread.join();
+}
+
+bool BackgroundDisassembler::isDisassembled(int fileId) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _jobIndices.find(fileId);
+  return it == _jobIndices.end() || _jobs[it->second].state == JobState::Done;
+}
+
+void BackgroundDisassembler::ensureDisassembled(int fileId) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  auto it = _jobIndices.find(fileId);
+  if (it == _jobIndices.end()) return;
+  size_t index = it->second;
+  if (_jobs[index].state == JobState::Pending) {
+    _jobs[index].state = JobState::Running;
+    lock.unlock();
+    disassemble(index);
+    return;
+  }
+  _doneCond.wait(lock, [&]() { return _jobs[index].state == JobState::Done; });
+}
+
+void BackgroundDisassembler::waitForAll() {
+  for (const auto& job : _jobIndices) ensureDisassembled(job.first);
+}
+
+void BackgroundDisassembler::run() {
+  while (true) {
+    size_t index;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      // files opened in the meantime were already done on the GUI thread
+      while (_nextJob < _jobs.size() &&
+             _jobs[_nextJob].state != JobState::Pending)
+        _nextJob++;
+      if (_stopping || _nextJob >= _jobs.size()) return;
+      index = _nextJob++;
+      _jobs[index].state = JobState::Running;
+    }
+    disassemble(index);
+  }
+}
+
+void BackgroundDisassembler::disassemble(size_t index) {
+  SCXFile* file = _jobs[index].file;
+  SC3BaseDisassembler* dis = _game->createDisassembler(*file);
+  dis->DisassembleFile();
+  delete dis;
+  if (_analyze) _analyze(file);
+
+  int done;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _jobs[index].state = JobState::Done;
+    done = ++_doneCount;
+  }
+  _doneCond.notify_all();
+  if (_onFileDone) _onFileDone(file->getId(), done, (int)_jobs.size());
+}
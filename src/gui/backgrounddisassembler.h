@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class SCXFile;
+class SupportedGame;
+
+// Disassembles a set of already loaded files on a pool of worker threads.
+// A file's disassembly must not be touched until isDisassembled() says so, or
+// ensureDisassembled() returned for it.
+class BackgroundDisassembler {
+ public:
+  // called on a worker thread (or in ensureDisassembled) after every file
+  typedef std::function<void(int fileId, int done, int total)> Callback;
+  // same, but before the file counts as disassembled, so whatever it builds
+  // from the disassembly is ready along with it
+  typedef std::function<void(const SCXFile* file)> Analyzer;
+
+  // threadCount 0 = one per core
+  BackgroundDisassembler(const SupportedGame* game,
+                         const std::vector<SCXFile*>& files,
+                         const Analyzer& analyze, const Callback& onFileDone,
+                         int threadCount = 0);
+  // files nobody started on yet are skipped, running ones are waited for
+  ~BackgroundDisassembler();
+
+  bool isDisassembled(int fileId) const;
+  // Disassembles the file right away on the calling thread if no worker has
+  // picked it up yet, otherwise waits for the worker.
+  void ensureDisassembled(int fileId);
+  void waitForAll();
+
+ private:
+  enum class JobState { Pending, Running, Done };
+  struct Job {
+    SCXFile* file;
+    JobState state;
+  };
+
+  const SupportedGame* _game;
+  Analyzer _analyze;
+  Callback _onFileDone;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _doneCond;
+  std::vector<Job> _jobs;
+  std::map<int, size_t> _jobIndices;
+  size_t _nextJob = 0;
+  int _doneCount = 0;
+  bool _stopping = false;
+  std::vector<std::thread> _threads;
+
+  void run();
+  void disassemble(size_t index);
+};
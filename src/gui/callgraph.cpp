@@ -0,0 +1,80 @@
+#include "callgraph.h"
+#include <algorithm>
+#include <tuple>
+
+bool CallGraph::kindForInstruction(const std::string &name, Kind &kind) {
+  if (name == "Call" || name == "CallIfFlag")
+    kind = LocalCall;
+  else if (name == "CallFar" || name == "CallFarIfFlag")
+    kind = FarCall;
+  else if (name == "JumpFar")
+    kind = FarJump;
+  else if (name == "CreateThread")
+    kind = ThreadEntry;
+  else
+    return false;
+  return true;
+}
+
+void CallGraph::addCall(int fromFileId, int fromLabelId, SCXOffset address,
+                        int toFileId, int toLabelId, Kind kind) {
+  _pending.push_back(
+      {fromFileId, fromLabelId, address, toFileId, toLabelId, kind});
+}
+
+void CallGraph::build() {
+  if (_pending.empty()) return;
+
+  _byCaller.insert(_byCaller.end(), _pending.begin(), _pending.end());
+  _byCallee.insert(_byCallee.end(), _pending.begin(), _pending.end());
+  _pending.clear();
+  _pending.shrink_to_fit();
+
+  std::sort(_byCaller.begin(), _byCaller.end(),
+            [](const Edge &a, const Edge &b) {
+              return std::tie(a.fromFileId, a.fromLabelId, a.address) <
+                     std::tie(b.fromFileId, b.fromLabelId, b.address);
+            });
+  std::sort(_byCallee.begin(), _byCallee.end(),
+            [](const Edge &a, const Edge &b) {
+              return std::tie(a.toFileId, a.toLabelId, a.fromFileId,
+                              a.address) < std::tie(b.toFileId, b.toLabelId,
+                                                    b.fromFileId, b.address);
+            });
+}
+
+void CallGraph::clear() {
+  _byCaller.clear();
+  _byCallee.clear();
+  _pending.clear();
+}
+
+std::vector<CallGraph::Call> CallGraph::callers(int fileId,
+                                                int labelId) const {
+  Edge key{0, 0, 0, fileId, labelId, LocalCall};
+  auto range = std::equal_range(_byCallee.begin(), _byCallee.end(), key,
+                                [](const Edge &a, const Edge &b) {
+                                  return std::tie(a.toFileId, a.toLabelId) <
+                                         std::tie(b.toFileId, b.toLabelId);
+                                });
+  std::vector<Call> result;
+  result.reserve(range.second - range.first);
+  for (auto it = range.first; it != range.second; it++)
+    result.push_back({it->fromFileId, it->fromLabelId, it->address, it->kind});
+  return result;
+}
+
+std::vector<CallGraph::Call> CallGraph::callees(int fileId,
+                                                int labelId) const {
+  Edge key{fileId, labelId, 0, 0, 0, LocalCall};
+  auto range = std::equal_range(_byCaller.begin(), _byCaller.end(), key,
+                                [](const Edge &a, const Edge &b) {
+                                  return std::tie(a.fromFileId, a.fromLabelId) <
+                                         std::tie(b.fromFileId, b.fromLabelId);
+                                });
+  std::vector<Call> result;
+  result.reserve(range.second - range.first);
+  for (auto it = range.first; it != range.second; it++)
+    result.push_back({it->toFileId, it->toLabelId, it->address, it->kind});
+  return result;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <parser/SCXTypes.h>
+
+// Whole-project graph of calls between labels. Only transfers into another
+// routine are edges: local and far calls, far jumps and thread entry points,
+// not branches or data references within a script.
+// Edges are kept in two sorted arrays (by caller and by callee), so both
+// directions are a binary search away.
+class CallGraph {
+ public:
+  enum Kind {
+    // Call, CallIfFlag
+    LocalCall,
+    // CallFar, CallFarIfFlag
+    FarCall,
+    // JumpFar
+    FarJump,
+    // CreateThread entry point
+    ThreadEntry
+  };
+
+  struct Call {
+    int fileId;
+    int labelId;
+    // where the call is, always in the calling label
+    SCXOffset address;
+    Kind kind;
+  };
+
+  // false for instructions that aren't calls
+  static bool kindForInstruction(const std::string &name, Kind &kind);
+
+  void addCall(int fromFileId, int fromLabelId, SCXOffset address,
+               int toFileId, int toLabelId, Kind kind);
+  // call after adding calls, before querying
+  void build();
+  void clear();
+
+  // labels calling (fileId, labelId)
+  std::vector<Call> callers(int fileId, int labelId) const;
+  // labels called from (fileId, labelId), address is the call site
+  std::vector<Call> callees(int fileId, int labelId) const;
+
+ private:
+  struct Edge {
+    int fromFileId;
+    int fromLabelId;
+    SCXOffset address;
+    int toFileId;
+    int toLabelId;
+    Kind kind;
+  };
+
+  // sorted by from, address
+  std::vector<Edge> _byCaller;
+  // sorted by to, from, address
+  std::vector<Edge> _byCallee;
+  std::vector<Edge> _pending;
+};
@@ -1,17 +1,54 @@
 #include "disassemblyitemdelegate.h"
 #include "disassemblymodel.h"
 #include <QPainter>
-#include <QTextDocument>
 #include <QApplication>
-#include <QAbstractTextDocumentLayout>
+#include <QEvent>
 #include "viewhelper.h"
 
+DisassemblyItemDelegate::DisassemblyItemDelegate(QWidget* parent)
+    : QStyledItemDelegate(parent), _cache(MaxCachedCells) {
+  _renderer.setStyleSheet(qApp->styleSheet());
+  // the view gets a StyleChange when the application style sheet is edited
+  if (parent != nullptr) parent->installEventFilter(this);
+}
+
+bool DisassemblyItemDelegate::eventFilter(QObject* watched, QEvent* event) {
+  if (event->type() == QEvent::StyleChange ||
+      event->type() == QEvent::FontChange) {
+    _renderer.setStyleSheet(qApp->styleSheet());
+    _cache.clear();
+  }
+  return QStyledItemDelegate::eventFilter(watched, event);
+}
+
+const StyledTextRenderer::Layout* DisassemblyItemDelegate::layoutFor(
+    const QStyleOptionViewItem& option, const QModelIndex& index) const {
+  int generation =
+      static_cast<const DisassemblyModel*>(index.model())->generation();
+  if (generation != _cacheGeneration) {
+    _cache.clear();
+    _cacheGeneration = generation;
+  }
+
+  QPair<int, int> key(index.row(), index.column());
+  StyledTextRenderer::Layout* layout = _cache.object(key);
+  if (layout != nullptr) return layout;
+
+  QString richText = richTextFor(index);
+  if (richText.isEmpty()) return nullptr;
+  layout = new StyledTextRenderer::Layout(_renderer.layout(
+      "<div class='disassemblyRow'>" + richText + "</div>", option.font,
+      option.palette.color(QPalette::Text)));
+  _cache.insert(key, layout);
+  return layout;
+}
+
 void DisassemblyItemDelegate::paint(QPainter* painter,
                                     const QStyleOptionViewItem& option,
                                     const QModelIndex& index) const {
-  QString richText = richTextFor(index);
-  if (!richText.isEmpty()) {
-    return paintRichText(painter, option, index, richText);
+  const StyledTextRenderer::Layout* layout = layoutFor(option, index);
+  if (layout != nullptr) {
+    return paintRichText(painter, option, index, *layout);
   }
 
   switch ((DisassemblyModel::ColumnType)index.column()) {
@@ -34,9 +71,9 @@ QString DisassemblyItemDelegate::richTextFor(const QModelIndex& index) const {
              displayTextForAddress(index.data().toInt()) + "</div>";
     }
     case DisassemblyModel::ColumnType::Code: {
-      const DisassemblyRow* row =
-          static_cast<DisassemblyRow*>(index.internalPointer());
-      switch (row->type) {
+      const DisassemblyModel* model =
+          static_cast<const DisassemblyModel*>(index.model());
+      switch (model->rowInfo(index.row()).type) {
         case DisassemblyModel::RowType::Comment: {
           return "<div class='comment'>" +
                  index.data().toString().toHtmlEscaped() + "</div>";
@@ -61,39 +98,28 @@ QString DisassemblyItemDelegate::richTextFor(const QModelIndex& index) const {
   return QString();
 }
 
-// https://stackoverflow.com/a/1956781
-void DisassemblyItemDelegate::paintRichText(QPainter* painter,
-                                            const QStyleOptionViewItem& option,
-                                            const QModelIndex& index,
-                                            const QString& richText) const {
+void DisassemblyItemDelegate::paintRichText(
+    QPainter* painter, const QStyleOptionViewItem& option,
+    const QModelIndex& index, const StyledTextRenderer::Layout& layout) const {
   QStyleOptionViewItem options = option;
   initStyleOption(&options, index);
 
   painter->save();
 
-  QTextDocument doc;
-  doc.setDefaultStyleSheet(qApp->styleSheet());
-  doc.setHtml("<div class='disassemblyRow'>" + richText + "</div>");
-
   const QWidget* widget = options.widget;
   QStyle* style = widget ? widget->style() : QApplication::style();
   options.text = "";
   style->drawControl(QStyle::CE_ItemViewItem, &options, painter, widget);
 
-  painter->translate(options.rect.left(), options.rect.top());
-  QRect clip(0, 0, options.rect.width(), options.rect.height());
-  doc.drawContents(painter, clip);
+  painter->setClipRect(options.rect, Qt::IntersectClip);
+  StyledTextRenderer::draw(painter, options.rect.topLeft(), layout);
 
   painter->restore();
 }
 
 QSize DisassemblyItemDelegate::sizeHint(const QStyleOptionViewItem& option,
                                         const QModelIndex& index) const {
-  QString richText = richTextFor(index);
-  if (richText.isEmpty()) return QStyledItemDelegate::sizeHint(option, index);
-
-  QTextDocument doc;
-  doc.setDefaultStyleSheet(qApp->styleSheet());
-  doc.setHtml("<div class='disassemblyRow'>" + richText + "</div>");
-  return QSize(doc.idealWidth(), doc.size().height());
-}
\ No newline at end of file
+  const StyledTextRenderer::Layout* layout = layoutFor(option, index);
+  if (layout == nullptr) return QStyledItemDelegate::sizeHint(option, index);
+  return layout->size;
+}
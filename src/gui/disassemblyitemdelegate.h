@@ -1,21 +1,40 @@
 #include <QStyledItemDelegate>
 #include <QModelIndex>
 #include <QStyleOptionViewItem>
+#include <QCache>
+#include <QPair>
+#include "styledtext.h"
 
 class DisassemblyItemDelegate : public QStyledItemDelegate {
   Q_OBJECT
 
  public:
-  DisassemblyItemDelegate(QWidget* parent = 0) : QStyledItemDelegate(parent) {}
+  DisassemblyItemDelegate(QWidget* parent = 0);
 
   void paint(QPainter* painter, const QStyleOptionViewItem& option,
              const QModelIndex& index) const override;
   QSize sizeHint(const QStyleOptionViewItem& option,
                  const QModelIndex& index) const override;
 
+ protected:
+  bool eventFilter(QObject* watched, QEvent* event) override;
+
  private:
+  // a few screens' worth
+  static const int MaxCachedCells = 4096;
+
+  StyledTextRenderer _renderer;
+  // Laid out rich text cells by (row, column), for the model generation in
+  // _cacheGeneration. Cells without rich text aren't cached.
+  mutable QCache<QPair<int, int>, StyledTextRenderer::Layout> _cache;
+  mutable int _cacheGeneration = -1;
+
+  // nullptr if the cell has no rich text
+  const StyledTextRenderer::Layout* layoutFor(
+      const QStyleOptionViewItem& option, const QModelIndex& index) const;
   void paintRichText(QPainter* painter, const QStyleOptionViewItem& option,
-                     const QModelIndex& index, const QString& richText) const;
+                     const QModelIndex& index,
+                     const StyledTextRenderer::Layout& layout) const;
 
   QString richTextFor(const QModelIndex& index) const;
-};
\ No newline at end of file
+};
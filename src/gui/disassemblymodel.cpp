@@ -4,13 +4,18 @@
 #include <sstream>
 #include "textdump.h"
 #include <algorithm>
+#include <tuple>
 #include "debuggerapplication.h"
 #include "project.h"
 #include "analysis.h"
 #include "viewhelper.h"
 
+static int lastGeneration = 0;
+
 DisassemblyModel::DisassemblyModel(const SCXFile *script, QObject *parent)
-    : QAbstractItemModel(parent), _script(script) {
+    : QAbstractTableModel(parent),
+      _script(script),
+      _renderer(true, dApp->project()->contextProvider(), script->getId()) {
   reload();
 
   connect(dApp->project(), &Project::commentChanged, this,
@@ -23,129 +28,133 @@ DisassemblyModel::DisassemblyModel(const SCXFile *script, QObject *parent)
           &DisassemblyModel::onAllVarsChanged);
 }
 
+void DisassemblyModel::invalidate() { _generation = ++lastGeneration; }
+
 void DisassemblyModel::reload() {
-  _labelRows.clear();
+  invalidate();
+  _rowsByLabel.clear();
+  for (auto &rows : _rowsByVar) rows.clear();
 
   int labelCount = _script->disassembly().size();
-  _labelRows.reserve(labelCount);
+  _labelFirstRow.assign(labelCount + 1, 0);
+  _labelFirstInst.assign(labelCount + 1, 0);
+  _commentedInsts.assign(labelCount, std::vector<int>());
+
+  // addresses only go up, so walk the comments alongside the instructions
+  const auto &comments = dApp->project()->getComments(_script->getId());
+  auto nextComment = comments.begin();
+
+  int row = 0, inst = 0;
   for (int i = 0; i < labelCount; i++) {
-    const SC3CodeBlock *label = _script->disassembly()[i].get();
-    DisassemblyRow labelRow;
-    labelRow.type = RowType::Label;
-    labelRow.id = i;
-    labelRow.address = label->address();
-    labelRow.parent = nullptr;
-    int instCount = label->instructions().size();
-    labelRow.children.reserve(instCount + 1);
-    _labelRows.push_back(std::move(labelRow));
-    DisassemblyRow *movedLabelRow = &_labelRows.data()[i];
-    for (int j = 0; j < instCount; j++) {
-      DisassemblyRow instRow;
-      instRow.type = RowType::Instruction;
-      instRow.id = j;
-      instRow.address = label->instructions()[j]->position();
-      instRow.parent = movedLabelRow;
-      movedLabelRow->children.push_back(std::move(instRow));
-      DisassemblyRow *movedInstRow = &movedLabelRow->children.data()[j];
-
-      QString comment =
-          dApp->project()->getComment(_script->getId(), movedInstRow->address);
-      if (!comment.isEmpty()) {
-        DisassemblyRow commentRow;
-        commentRow.type = RowType::Comment;
-        commentRow.id = 0;
-        commentRow.address = movedInstRow->address;
-        commentRow.parent = movedInstRow;
-        movedInstRow->children.push_back(std::move(commentRow));
+    const auto &insts = _script->disassembly()[i]->instructions();
+    _labelFirstRow[i] = row;
+    _labelFirstInst[i] = inst;
+    row += 1 + insts.size();
+    inst += insts.size();
+    for (int j = 0; j < (int)insts.size(); j++) {
+      SCXOffset address = insts[j]->position();
+      while (nextComment != comments.end() && nextComment->first < address)
+        nextComment++;
+      if (nextComment != comments.end() && nextComment->first == address) {
+        _commentedInsts[i].push_back(j);
+        row++;
       }
     }
   }
+  _labelFirstRow[labelCount] = row;
+  _labelFirstInst[labelCount] = inst;
+
+  _codeText.assign(inst, QString());
+  _refsIndexed.assign(inst, false);
 }
 
 int DisassemblyModel::rowCount(const QModelIndex &parent) const {
-  if (!parent.isValid()) {
-    return _labelRows.size();
-  }
-  const DisassemblyRow *parentRow =
-      static_cast<DisassemblyRow *>(parent.internalPointer());
-  if (parentRow == nullptr) return 0;
-  return parentRow->children.size();
+  if (parent.isValid()) return 0;
+  return _labelFirstRow.back();
 }
 
 int DisassemblyModel::columnCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
   return (int)ColumnType::NumColumns;
 }
 
+int DisassemblyModel::rowForInstruction(int labelId, int instId) const {
+  const auto &commented = _commentedInsts[labelId];
+  int commentsBefore =
+      std::lower_bound(commented.begin(), commented.end(), instId) -
+      commented.begin();
+  return _labelFirstRow[labelId] + 1 + instId + commentsBefore;
+}
+
+DisassemblyModel::RowInfo DisassemblyModel::rowInfo(int row) const {
+  RowInfo info;
+  // every label has a row of its own, so first rows are strictly ascending
+  info.labelId = std::upper_bound(_labelFirstRow.begin(),
+                                  _labelFirstRow.end() - 1, row) -
+                 _labelFirstRow.begin() - 1;
+  int offset = row - _labelFirstRow[info.labelId];
+  if (offset == 0) {
+    info.type = RowType::Label;
+    info.instId = -1;
+    return info;
+  }
+
+  // last instruction starting at or before the row
+  int lo = 0;
+  int hi = _labelFirstInst[info.labelId + 1] - _labelFirstInst[info.labelId] -
+           1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (rowForInstruction(info.labelId, mid) <= row)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  info.instId = lo;
+  info.type = rowForInstruction(info.labelId, lo) == row ? RowType::Instruction
+                                                          : RowType::Comment;
+  return info;
+}
+
 bool DisassemblyModel::indexIsLabel(const QModelIndex &index) const {
   if (!index.isValid()) return false;
-  const DisassemblyRow *row =
-      static_cast<DisassemblyRow *>(index.internalPointer());
-  if (row == nullptr) return false;
-  return row->type == RowType::Label;
+  return rowInfo(index.row()).type == RowType::Label;
 }
 
 const SC3CodeBlock *DisassemblyModel::labelForIndex(
     const QModelIndex &index) const {
   if (!index.isValid()) return nullptr;
-  const DisassemblyRow *row =
-      static_cast<DisassemblyRow *>(index.internalPointer());
-  while (row != nullptr) {
-    if (row->type == RowType::Label)
-      return _script->disassembly()[row->id].get();
-    row = row->parent;
-  }
-  return nullptr;
+  return _script->disassembly()[rowInfo(index.row()).labelId].get();
 }
 
 QModelIndex DisassemblyModel::indexForLabel(SCXOffset labelId) const {
-  if (labelId > _labelRows.size()) return QModelIndex();
-  return createIndex(labelId, 0, (void *)&_labelRows.data()[labelId]);
+  if (labelId < 0 || labelId >= (int)_commentedInsts.size())
+    return QModelIndex();
+  return index(_labelFirstRow[labelId], 0);
 }
 
 QModelIndex DisassemblyModel::firstIndexForAddress(SCXOffset address) const {
   int labelId = firstLabelForAddress(_script, address);
   if (labelId < 0) return QModelIndex();
-  if (_labelRows[labelId].address == address) return indexForLabel(labelId);
+  if (_script->disassembly()[labelId]->address() == address)
+    return indexForLabel(labelId);
   int instId = instIdAtAddress(_script, labelId, address);
   if (instId < 0) return indexForLabel(labelId);
-  return createIndex(instId, 0,
-                     (void *)&_labelRows[labelId].children.data()[instId]);
+  return index(rowForInstruction(labelId, instId), 0);
 }
 
 SCXOffset DisassemblyModel::addressForIndex(const QModelIndex &index) const {
   if (!index.isValid()) return -1;
-  const DisassemblyRow *row =
-      static_cast<DisassemblyRow *>(index.internalPointer());
-  if (row == nullptr) return -1;
-
-  return row->address;
-}
-
-QModelIndex DisassemblyModel::index(int row, int column,
-                                    const QModelIndex &parent) const {
-  if (!parent.isValid())
-    return createIndex(row, column, (void *)&_labelRows.data()[row]);
-  const DisassemblyRow *parentRow =
-      static_cast<DisassemblyRow *>(parent.internalPointer());
-  if (parentRow == nullptr) return QModelIndex();
-  if (row >= parentRow->children.size()) return QModelIndex();
-  return createIndex(row, column, (void *)&parentRow->children.data()[row]);
-}
-
-QModelIndex DisassemblyModel::parent(const QModelIndex &index) const {
-  if (!index.isValid()) return QModelIndex();
-
-  const DisassemblyRow *row =
-      static_cast<DisassemblyRow *>(index.internalPointer());
-
-  if (row == nullptr) return QModelIndex();
-  if (row->parent == nullptr) return QModelIndex();
-  return createIndex(row->parent->id, 0, row->parent);
+  RowInfo info = rowInfo(index.row());
+  const SC3CodeBlock *label = _script->disassembly()[info.labelId].get();
+  if (info.type == RowType::Label) return label->address();
+  return label->instructions()[info.instId]->position();
 }
 
 QVariant DisassemblyModel::headerData(int section, Qt::Orientation orientation,
                                       int role) const {
-  if (role != Qt::DisplayRole) return QVariant();
+  if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+    return QVariant();
   switch ((ColumnType)section) {
     case ColumnType::Address:
       return "Address";
@@ -161,37 +170,33 @@ QVariant DisassemblyModel::data(const QModelIndex &index, int role) const {
   if (!index.isValid()) return QVariant();
   if (role != Qt::DisplayRole) return QVariant();
 
-  const DisassemblyRow *row =
-      static_cast<DisassemblyRow *>(index.internalPointer());
-  if (row == nullptr) return QVariant();
+  RowInfo info = rowInfo(index.row());
+  const SC3CodeBlock *label = _script->disassembly()[info.labelId].get();
 
   switch ((ColumnType)index.column()) {
     case ColumnType::Address:
-      return QVariant(row->address);
+      return QVariant(addressForIndex(index));
     case ColumnType::Code: {
-      const SC3CodeBlock *label = labelForIndex(index);
-      switch (row->type) {
+      switch (info.type) {
         case RowType::Label: {
           return QVariant(
               dApp->project()->getLabelName(_script->getId(), label->id()));
         }
         case RowType::Instruction: {
-          const SC3Instruction *inst = label->instructions()[row->id].get();
-          return QVariant(QString::fromStdString(
-              DumpSC3InstructionToText(true, dApp->project()->contextProvider(),
-                                       _script->getId(), inst)));
+          return QVariant(codeTextFor(info.labelId, info.instId));
         }
         case RowType::Comment: {
-          return QVariant("; " + dApp->project()->getComment(_script->getId(),
-                                                             row->address));
+          return QVariant(
+              "; " + dApp->project()->getComment(
+                         _script->getId(),
+                         label->instructions()[info.instId]->position()));
         }
         default: { return QVariant(); }
       }
     }
     case ColumnType::Text: {
-      if (row->type != RowType::Instruction) return QVariant();
-      const SC3CodeBlock *label = labelForIndex(index);
-      const SC3Instruction *inst = label->instructions()[row->id].get();
+      if (info.type != RowType::Instruction) return QVariant();
+      const SC3Instruction *inst = label->instructions()[info.instId].get();
       return QVariant(firstStringInInstruction(inst));
     }
     default: { return QVariant(); }
@@ -200,12 +205,36 @@ QVariant DisassemblyModel::data(const QModelIndex &index, int role) const {
 
 Qt::ItemFlags DisassemblyModel::flags(const QModelIndex &index) const {
   if (!index.isValid()) return 0;
-  Qt::ItemFlags result = QAbstractItemModel::flags(index);
-  const DisassemblyRow *row =
-      static_cast<DisassemblyRow *>(index.internalPointer());
-  if (row == nullptr) return 0;
-  if (row->children.size() == 0) result |= Qt::ItemFlag::ItemNeverHasChildren;
-  return result;
+  return QAbstractTableModel::flags(index) | Qt::ItemNeverHasChildren;
+}
+
+QString DisassemblyModel::codeTextFor(int labelId, int instId) const {
+  const SC3Instruction *inst =
+      _script->disassembly()[labelId]->instructions()[instId].get();
+  int flatId = _labelFirstInst[labelId] + instId;
+  if (!_refsIndexed[flatId]) {
+    std::pair<int, int> position(labelId, instId);
+    for (const auto &ref : variableRefsInInstruction(inst))
+      _rowsByVar[(int)ref.first][ref.second].push_back(position);
+    for (int ref : localLabelRefsInInstruction(inst))
+      _rowsByLabel[ref].push_back(position);
+    _refsIndexed[flatId] = true;
+  }
+  QString &text = _codeText[flatId];
+  if (text.isEmpty()) {
+    text = QString::fromStdString(_renderer.instructionText(inst));
+  }
+  return text;
+}
+
+void DisassemblyModel::invalidateRows(const RowList &rows) {
+  for (const auto &position : rows) {
+    _codeText[_labelFirstInst[position.first] + position.second].clear();
+    QModelIndex changed =
+        index(rowForInstruction(position.first, position.second),
+              (int)ColumnType::Code);
+    emit dataChanged(changed, changed);
+  }
 }
 
 QString DisassemblyModel::firstStringInInstruction(
@@ -228,42 +257,30 @@ void DisassemblyModel::onCommentChanged(int fileId, SCXOffset address,
   int labelId, instId;
   std::tie(labelId, instId) = instIdAtAddress(_script, address);
   if (labelId < 0 || instId < 0) return;
-
-  DisassemblyRow *instructionRow = &_labelRows[labelId].children.data()[instId];
+  invalidate();
 
   // TODO multiline
 
+  int commentRow = rowForInstruction(labelId, instId) + 1;
+  auto &commented = _commentedInsts[labelId];
+  auto it = std::lower_bound(commented.begin(), commented.end(), instId);
+  bool hadComment = it != commented.end() && *it == instId;
+
   if (comment.isEmpty()) {
-    for (auto it = instructionRow->children.begin();
-         it != instructionRow->children.end(); it++) {
-      if (it->type == RowType::Comment) {
-        beginRemoveRows(createIndex(instId, 0, instructionRow),
-                        it - instructionRow->children.begin(),
-                        it - instructionRow->children.begin());
-        instructionRow->children.erase(it);
-        endRemoveRows();
-        return;
-      }
-    }
+    if (!hadComment) return;
+    beginRemoveRows(QModelIndex(), commentRow, commentRow);
+    commented.erase(it);
+    for (size_t i = labelId + 1; i < _labelFirstRow.size(); i++)
+      _labelFirstRow[i]--;
+    endRemoveRows();
+  } else if (hadComment) {
+    QModelIndex changed = index(commentRow, (int)ColumnType::Code);
+    emit dataChanged(changed, changed);
   } else {
-    for (int i = 0; i < instructionRow->children.size(); i++) {
-      if (instructionRow->children[i].type == RowType::Comment) {
-        auto index =
-            createIndex(i, (int)ColumnType::Code, (void *)instructionRow);
-        emit dataChanged(index, index);
-        return;
-      }
-    }
-
-    // no existing comment
-    beginInsertRows(createIndex(instId, 0, instructionRow), 0, 0);
-    DisassemblyRow commentRow;
-    commentRow.id = instructionRow->children.size();
-    commentRow.address = instructionRow->address;
-    commentRow.type = RowType::Comment;
-    commentRow.parent = instructionRow;
-    instructionRow->children.insert(instructionRow->children.begin(),
-                                    std::move(commentRow));
+    beginInsertRows(QModelIndex(), commentRow, commentRow);
+    commented.insert(it, instId);
+    for (size_t i = labelId + 1; i < _labelFirstRow.size(); i++)
+      _labelFirstRow[i]++;
     endInsertRows();
   }
 }
@@ -271,26 +288,28 @@ void DisassemblyModel::onCommentChanged(int fileId, SCXOffset address,
 void DisassemblyModel::onLabelNameChanged(int fileId, int labelId,
                                           const QString &name) {
   if (fileId != _script->getId()) return;
-  if (labelId < 0 || labelId >= _labelRows.size()) return;
-
-  // slow but easy way to invalidate all code rows, for xrefs
-  beginResetModel();
-  endResetModel();
+  if (labelId < 0 || labelId >= (int)_commentedInsts.size()) return;
+  invalidate();
 
-  /*
-  QModelIndex origIndex = indexForLabel(labelId);
-  QModelIndex codeIndex = createIndex(origIndex.row(), (int)ColumnType::Code,
-                                      origIndex.internalPointer());
+  QModelIndex codeIndex =
+      index(_labelFirstRow[labelId], (int)ColumnType::Code);
   emit dataChanged(codeIndex, codeIndex);
-  */
+  auto it = _rowsByLabel.find(labelId);
+  if (it != _rowsByLabel.end()) invalidateRows(it->second);
 }
 
 void DisassemblyModel::onVarNameChanged(VariableRefType type, int var,
                                         const QString &name) {
-  beginResetModel();
-  endResetModel();
+  auto it = _rowsByVar[(int)type].find(var);
+  if (it == _rowsByVar[(int)type].end()) return;
+  invalidate();
+  invalidateRows(it->second);
 }
+
 void DisassemblyModel::onAllVarsChanged() {
-  beginResetModel();
-  endResetModel();
-}
\ No newline at end of file
+  invalidate();
+  for (auto &text : _codeText) text.clear();
+  if (rowCount() == 0) return;
+  emit dataChanged(index(0, (int)ColumnType::Code),
+                   index(rowCount() - 1, (int)ColumnType::Code));
+}
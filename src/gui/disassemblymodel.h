@@ -1,39 +1,53 @@
 #pragma once
-#include <QAbstractItemModel>
+#include <QAbstractTableModel>
 #include <QModelIndex>
 #include <QVariant>
 #include "parser/SCXTypes.h"
 #include "enums.h"
+#include "textdump.h"
 #include <vector>
+#include <unordered_map>
 #include <utility>
 
 class SCXFile;
 class SC3CodeBlock;
 class SC3Instruction;
-struct DisassemblyRow;
 
-class DisassemblyModel : public QAbstractItemModel {
+// One row per label, instruction and comment (after its instruction), in
+// address order. Rows aren't stored: each label's first row is kept as a
+// prefix sum, plus which of its instructions have a comment row, so mapping
+// rows to labels/instructions and back is a binary search.
+class DisassemblyModel : public QAbstractTableModel {
   Q_OBJECT
 
  public:
   enum class ColumnType { Breakpoint, Address, Code, Text, NumColumns };
   enum class RowType { Label, Instruction, Comment, Blank };
 
+  struct RowInfo {
+    RowType type;
+    int labelId;
+    // -1 for label rows
+    int instId;
+  };
+
   explicit DisassemblyModel(const SCXFile* script, QObject* parent = 0);
   ~DisassemblyModel() {}
 
   const SCXFile* script() const { return _script; }
+  // Changes whenever rendered text or row numbers might have, so views can
+  // cache per row. Unique across models.
+  int generation() const { return _generation; }
 
   QVariant data(const QModelIndex& index, int role) const override;
   Qt::ItemFlags flags(const QModelIndex& index) const override;
   QVariant headerData(int section, Qt::Orientation orientation,
                       int role = Qt::DisplayRole) const override;
-  QModelIndex index(int row, int column,
-                    const QModelIndex& parent = QModelIndex()) const override;
-  QModelIndex parent(const QModelIndex& index) const override;
   int rowCount(const QModelIndex& parent = QModelIndex()) const override;
   int columnCount(const QModelIndex& parent = QModelIndex()) const override;
 
+  RowInfo rowInfo(int row) const;
+
   QModelIndex firstIndexForAddress(SCXOffset address) const;
   SCXOffset addressForIndex(const QModelIndex& index) const;
 
@@ -49,17 +63,32 @@ class DisassemblyModel : public QAbstractItemModel {
 
  private:
   const SCXFile* _script;
-  std::vector<DisassemblyRow> _labelRows;
+  int _generation;
+  mutable SC3TextRenderer _renderer;
+
+  // row of each label, plus the total row count at the end
+  std::vector<int> _labelFirstRow;
+  // same for flat instruction indices, which the caches below use
+  std::vector<int> _labelFirstInst;
+  // per label, ascending ids of instructions followed by a comment row
+  std::vector<std::vector<int>> _commentedInsts;
+
+  // rendered Code column of instruction rows, empty until needed
+  mutable std::vector<QString> _codeText;
+  mutable std::vector<bool> _refsIndexed;
+  // instructions (labelId, instId) whose text uses a name, filled in as
+  // rows are first rendered
+  typedef std::vector<std::pair<int, int>> RowList;
+  mutable std::unordered_map<int, RowList> _rowsByLabel;
+  mutable std::unordered_map<int, RowList> _rowsByVar[2];
+
+  void invalidate();
+  void invalidateRows(const RowList& rows);
+  QString codeTextFor(int labelId, int instId) const;
+
+  int rowForInstruction(int labelId, int instId) const;
 
   void reload();
 
   QString firstStringInInstruction(const SC3Instruction* inst) const;
 };
-
-struct DisassemblyRow {
-  DisassemblyModel::RowType type;
-  int id;
-  SCXOffset address;
-  std::vector<DisassemblyRow> children;
-  DisassemblyRow* parent;
-};
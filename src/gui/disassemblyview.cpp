@@ -4,27 +4,33 @@
 #include "project.h"
 #include "debuggerapplication.h"
 #include <QAction>
+#include <QEvent>
 #include <QInputDialog>
 #include <QShortcut>
 #include "xrefdialog.h"
 
-DisassemblyView::DisassemblyView(QWidget* parent) : QTreeView(parent) {
+DisassemblyView::DisassemblyView(QWidget* parent) : QTableView(parent) {
   connect(dApp, &DebuggerApplication::projectOpened, this,
           &DisassemblyView::onProjectOpened);
   connect(dApp, &DebuggerApplication::projectClosed, this,
           &DisassemblyView::onProjectClosed);
 
-  connect(header(), &QHeaderView::sectionCountChanged, this,
+  connect(horizontalHeader(), &QHeaderView::sectionCountChanged, this,
           &DisassemblyView::adjustHeader);
 
-  header()->setSectionsMovable(false);
-  header()->setSectionsClickable(false);
+  horizontalHeader()->setSectionsMovable(false);
+  horizontalHeader()->setSectionsClickable(false);
+  horizontalHeader()->setHighlightSections(false);
+  horizontalHeader()->setStretchLastSection(true);
+  verticalHeader()->setVisible(false);
+  verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
 
-  setUniformRowHeights(true);
-  setItemsExpandable(false);
+  setShowGrid(false);
   setWordWrap(false);
-  setIndentation(0);
-  setRootIsDecorated(false);
+  setCornerButtonEnabled(false);
+  setTabKeyNavigation(false);
+  setSelectionBehavior(QAbstractItemView::SelectRows);
+  setSelectionMode(QAbstractItemView::SingleSelection);
 
   setItemDelegate(new DisassemblyItemDelegate(this));
 
@@ -40,6 +46,14 @@ DisassemblyView::DisassemblyView(QWidget* parent) : QTreeView(parent) {
   connect(xrefShortcut, &QShortcut::activated, this,
           &DisassemblyView::onXrefKeyPress);
   xrefShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+  QShortcut* callersShortcut = new QShortcut(Qt::Key_K, this);
+  connect(callersShortcut, &QShortcut::activated, this,
+          &DisassemblyView::onCallersKeyPress);
+  callersShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+  QShortcut* calleesShortcut = new QShortcut(Qt::SHIFT + Qt::Key_K, this);
+  connect(calleesShortcut, &QShortcut::activated, this,
+          &DisassemblyView::onCalleesKeyPress);
+  calleesShortcut->setContext(Qt::WidgetWithChildrenShortcut);
 
   _resizeTimer = new QTimer(this);
   _resizeTimer->setSingleShot(true);
@@ -51,7 +65,7 @@ DisassemblyView::DisassemblyView(QWidget* parent) : QTreeView(parent) {
 }
 
 void DisassemblyView::resizeEvent(QResizeEvent* event) {
-  QTreeView::resizeEvent(event);
+  QTableView::resizeEvent(event);
   // prevent repaint during resize
   _isResizing = true;
   _resizeTimer->start();
@@ -59,28 +73,29 @@ void DisassemblyView::resizeEvent(QResizeEvent* event) {
 
 void DisassemblyView::paintEvent(QPaintEvent* event) {
   if (_isResizing) return;
-  QTreeView::paintEvent(event);
+  QTableView::paintEvent(event);
 }
 
-void DisassemblyView::setModel(QAbstractItemModel* model) {
-  QTreeView::setModel(model);
-  connect(model, &QAbstractItemModel::modelReset, this,
-          &DisassemblyView::onModelReset);
-  connect(model, &QAbstractItemModel::rowsInserted, this,
-          &DisassemblyView::onModelReset);
+void DisassemblyView::changeEvent(QEvent* event) {
+  QTableView::changeEvent(event);
+  if (event->type() == QEvent::StyleChange ||
+      event->type() == QEvent::FontChange)
+    adjustRowHeight();
+}
 
-  expandAll();
+void DisassemblyView::setModel(QAbstractItemModel* model) {
+  QTableView::setModel(model);
+  adjustRowHeight();
   scrollToTop();
 }
 
-void DisassemblyView::onModelReset() {
-  setUniformRowHeights(true);
-  setItemsExpandable(false);
-  setWordWrap(false);
-  setIndentation(0);
-  setRootIsDecorated(false);
-
-  expandAll();
+// rows all look alike, so ask once instead of per row
+void DisassemblyView::adjustRowHeight() {
+  if (model() == nullptr || model()->rowCount() == 0) return;
+  QSize size = itemDelegate()->sizeHint(
+      viewOptions(),
+      model()->index(0, (int)DisassemblyModel::ColumnType::Code));
+  verticalHeader()->setDefaultSectionSize(size.height());
 }
 
 void DisassemblyView::goToAddress(SCXOffset address) {
@@ -105,12 +120,13 @@ void DisassemblyView::goToLabel(int labelId) {
 
 void DisassemblyView::adjustHeader(int oldCount, int newCount) {
   if (newCount != (int)DisassemblyModel::ColumnType::NumColumns) return;
-  header()->setSectionResizeMode((int)DisassemblyModel::ColumnType::Breakpoint,
-                                 QHeaderView::Fixed);
+  QHeaderView* header = horizontalHeader();
+  header->setSectionResizeMode((int)DisassemblyModel::ColumnType::Breakpoint,
+                               QHeaderView::Fixed);
   // TODO: make breakpoint bounding rectangle square
-  header()->resizeSection((int)DisassemblyModel::ColumnType::Breakpoint, 24);
-  header()->setSectionResizeMode((int)DisassemblyModel::ColumnType::Address,
-                                 QHeaderView::ResizeToContents);
+  header->resizeSection((int)DisassemblyModel::ColumnType::Breakpoint, 24);
+  header->setSectionResizeMode((int)DisassemblyModel::ColumnType::Address,
+                               QHeaderView::ResizeToContents);
 }
 
 void DisassemblyView::onProjectOpened() {
@@ -153,34 +169,56 @@ void DisassemblyView::onNameKeyPress() {
   const DisassemblyModel* disModel = qobject_cast<DisassemblyModel*>(model());
   if (disModel == nullptr) return;
 
-  const DisassemblyRow* row =
-      static_cast<DisassemblyRow*>(currentIndex().internalPointer());
-  if (row == nullptr) return;
-  if (row->type != DisassemblyModel::RowType::Label) return;
+  if (!currentIndex().isValid()) return;
+  DisassemblyModel::RowInfo row = disModel->rowInfo(currentIndex().row());
+  if (row.type != DisassemblyModel::RowType::Label) return;
 
   QString oldName =
-      dApp->project()->getLabelName(disModel->script()->getId(), row->id);
+      dApp->project()->getLabelName(disModel->script()->getId(), row.labelId);
 
   bool ok;
   QString newName = QInputDialog::getText(
       this, "Edit label name", "New name:", QLineEdit::Normal, oldName, &ok);
   if (!ok) return;
-  dApp->project()->setLabelName(disModel->script()->getId(), row->id, newName);
+  dApp->project()->setLabelName(disModel->script()->getId(), row.labelId,
+                                newName);
 }
 
 void DisassemblyView::onXrefKeyPress() {
   const DisassemblyModel* disModel = qobject_cast<DisassemblyModel*>(model());
   if (disModel == nullptr) return;
 
-  const DisassemblyRow* row =
-      static_cast<DisassemblyRow*>(currentIndex().internalPointer());
-  if (row == nullptr) return;
-  if (row->type == DisassemblyModel::RowType::Label) {
-    XrefDialog(disModel->script()->getId(), row->id, true, this).exec();
+  if (!currentIndex().isValid()) return;
+  DisassemblyModel::RowInfo row = disModel->rowInfo(currentIndex().row());
+  if (row.type == DisassemblyModel::RowType::Label) {
+    XrefDialog(disModel->script()->getId(), row.labelId, true, this).exec();
   } else {
     SCXOffset address = disModel->addressForIndex(currentIndex());
     if (address < 0) return;
 
     XrefDialog(disModel->script()->getId(), address, false, this).exec();
   }
+}
+
+// of the label the current row is in
+void DisassemblyView::onCallersKeyPress() {
+  const DisassemblyModel* disModel = qobject_cast<DisassemblyModel*>(model());
+  if (disModel == nullptr) return;
+
+  if (!currentIndex().isValid()) return;
+  DisassemblyModel::RowInfo row = disModel->rowInfo(currentIndex().row());
+  XrefDialog(XrefDialog::CallDirection::Callers, disModel->script()->getId(),
+             row.labelId, this)
+      .exec();
+}
+
+void DisassemblyView::onCalleesKeyPress() {
+  const DisassemblyModel* disModel = qobject_cast<DisassemblyModel*>(model());
+  if (disModel == nullptr) return;
+
+  if (!currentIndex().isValid()) return;
+  DisassemblyModel::RowInfo row = disModel->rowInfo(currentIndex().row());
+  XrefDialog(XrefDialog::CallDirection::Callees, disModel->script()->getId(),
+             row.labelId, this)
+      .exec();
 }
\ No newline at end of file
@@ -1,11 +1,13 @@
 #pragma once
-#include <QTreeView>
+#include <QTableView>
 #include <QHeaderView>
 #include <QAbstractItemModel>
 #include "parser/SCXTypes.h"
 #include <QTimer>
 
-class DisassemblyView : public QTreeView {
+// Flat table over a DisassemblyModel with fixed row heights, so only the
+// visible rows are ever laid out or painted.
+class DisassemblyView : public QTableView {
   Q_OBJECT
  public:
   explicit DisassemblyView(QWidget *parent = 0);
@@ -20,6 +22,7 @@ class DisassemblyView : public QTreeView {
  private:
   void resizeEvent(QResizeEvent *event) override;
   void paintEvent(QPaintEvent *event) override;
+  void changeEvent(QEvent *event) override;
 
   QTimer *_resizeTimer;
   bool _isResizing = false;
@@ -28,8 +31,10 @@ class DisassemblyView : public QTreeView {
   void onCommentKeyPress();
   void onNameKeyPress();
   void onXrefKeyPress();
+  void onCallersKeyPress();
+  void onCalleesKeyPress();
 
-  void onModelReset();
+  void adjustRowHeight();
   void adjustHeader(int oldCount, int newCount);
 
   void onProjectOpened();
@@ -6,6 +6,8 @@ namespace sc3ntist {
 Q_NAMESPACE
 enum class VariableRefType { GlobalVar, Flag };
 Q_ENUM_NS(VariableRefType)
+// what a go to anything result points at
+enum class GoToKind { File, Label, GlobalVar, Flag, String };
 }  // namespace sc3ntist
 
 using namespace sc3ntist;
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "fuzzyindex.h"
+#include <algorithm>
+
+int FuzzyIndex::add(int kind, int fileId, int id, const QString& text) {
+  _keys.push_back({kind, fileId, id});
+  _texts.push_back(text);
+  _folded.push_back(text.toCaseFolded());
+  _masks.push_back(charMask(_folded.back()));
+  _lastQuery.clear();
+  return (int)_keys.size() - 1;
+}
+
+void FuzzyIndex::setText(int entry, const QString& text) {
+  if (entry < 0 || entry >= size()) return;
+  _texts[entry] = text;
+  _folded[entry] = text.toCaseFolded();
+  _masks[entry] = charMask(_folded[entry]);
+  _lastQuery.clear();
+}
+
+void FuzzyIndex::clear() {
+  _keys.clear();
+  _texts.clear();
+  _folded.clear();
+  _masks.clear();
+  _lastQuery.clear();
+  _lastMatches.clear();
+}
+
+uint64_t FuzzyIndex::charMask(const QString& folded) {
+  uint64_t mask = 0;
+  for (QChar c : folded) {
+    ushort u = c.unicode();
+    int bit;
+    if (u >= 'a' && u <= 'z')
+      bit = u - 'a';
+    else if (u >= '0' && u <= '9')
+      bit = 26 + (u - '0');
+    else
+      bit = 36 + u % 28;
+    mask |= 1ULL << bit;
+  }
+  return mask;
+}
+
+static bool isWordStart(const QString& text, int i) {
+  if (i == 0) return true;
+  QChar prev = text[i - 1];
+  return !prev.isLetterOrNumber() ||
+         (prev.isLetter() && text[i].isDigit());
+}
+
+int FuzzyIndex::score(const QString& folded, const QString& query) {
+  // a contiguous match beats any scattered one
+  int pos = folded.indexOf(query);
+  if (pos >= 0) {
+    int result = 1000 + 10 * query.size();
+    if (pos == 0)
+      result += 500;
+    else if (isWordStart(folded, pos))
+      result += 200;
+    if (query.size() == folded.size()) result += 500;
+    return result - folded.size();
+  }
+
+  // greedy subsequence, rewarding runs and word starts
+  int result = 0, run = 0, next = 0;
+  for (QChar c : query) {
+    int i = folded.indexOf(c, next);
+    if (i < 0) return -1;
+    if (i == next && next > 0) {
+      run++;
+      result += 5 * run;
+    } else {
+      run = 0;
+      result -= std::min(i - next, 10);
+    }
+    if (isWordStart(folded, i)) result += 8;
+    next = i + 1;
+  }
+  return std::max(result - folded.size() / 4, 0);
+}
+
+std::vector<FuzzyIndex::Hit> FuzzyIndex::search(const QString& query,
+                                                int maxHits) const {
+  std::vector<Hit> hits;
+  QString folded = query.toCaseFolded();
+  if (folded.isEmpty()) {
+    _lastQuery.clear();
+    return hits;
+  }
+  uint64_t mask = charMask(folded);
+
+  // anything matching the longer query also matched the shorter one
+  bool narrowing = !_lastQuery.isEmpty() && folded.startsWith(_lastQuery);
+  std::vector<int> matches;
+  auto check = [&](int entry) {
+    if ((_masks[entry] & mask) != mask) return;
+    int s = score(_folded[entry], folded);
+    if (s < 0) return;
+    matches.push_back(entry);
+    hits.push_back({entry, s});
+  };
+  if (narrowing) {
+    for (int entry : _lastMatches) check(entry);
+  } else {
+    for (int entry = 0; entry < size(); entry++) check(entry);
+  }
+  _lastQuery = folded;
+  _lastMatches.swap(matches);
+
+  auto better = [](const Hit& a, const Hit& b) {
+    return a.score != b.score ? a.score > b.score : a.entry < b.entry;
+  };
+  if ((int)hits.size() > maxHits) {
+    std::partial_sort(hits.begin(), hits.begin() + maxHits, hits.end(),
+                      better);
+    hits.resize(maxHits);
+  } else {
+    std::sort(hits.begin(), hits.end(), better);
+  }
+  return hits;
+}
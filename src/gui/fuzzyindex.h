@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <QString>
+
+// Fuzzy finder over short texts: a query matches if its characters appear in
+// the text in order. Each text gets a 64-bit mask of the characters it
+// contains, so most texts are ruled out with a single AND. Typing more of the
+// same query only rescans what matched the previous one.
+class FuzzyIndex {
+ public:
+  struct Hit {
+    int entry;
+    int score;
+  };
+
+  // returns the entry number
+  int add(int kind, int fileId, int id, const QString& text);
+  void setText(int entry, const QString& text);
+  void clear();
+
+  int size() const { return (int)_keys.size(); }
+  int kind(int entry) const { return _keys[entry].kind; }
+  int fileId(int entry) const { return _keys[entry].fileId; }
+  int id(int entry) const { return _keys[entry].id; }
+  const QString& text(int entry) const { return _texts[entry]; }
+
+  // case-insensitive, best first
+  std::vector<Hit> search(const QString& query, int maxHits) const;
+
+ private:
+  struct Key {
+    int kind;
+    int fileId;
+    int id;
+  };
+
+  std::vector<Key> _keys;
+  std::vector<QString> _texts;
+  // case folded
+  std::vector<QString> _folded;
+  std::vector<uint64_t> _masks;
+
+  // matches of the last query, for narrowing down the next one
+  mutable QString _lastQuery;
+  mutable std::vector<int> _lastMatches;
+
+  static uint64_t charMask(const QString& folded);
+  // < 0 if it doesn't match
+  static int score(const QString& folded, const QString& query);
+};
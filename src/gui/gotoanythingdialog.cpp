@@ -0,0 +1,138 @@
+#include "gotoanythingdialog.h"
+#include "debuggerapplication.h"
+#include "project.h"
+#include <QHeaderView>
+#include <QKeyEvent>
+#include <QVBoxLayout>
+
+GoToAnythingDialog::GoToAnythingDialog(QWidget *parent) : QDialog(parent) {
+  setWindowTitle("Go to anything");
+
+  _queryEdit = new QLineEdit(this);
+  _queryEdit->setPlaceholderText("Script, label, variable or text");
+  _queryEdit->installEventFilter(this);
+  connect(_queryEdit, &QLineEdit::textChanged, this,
+          &GoToAnythingDialog::search);
+  connect(_queryEdit, &QLineEdit::returnPressed, this,
+          &GoToAnythingDialog::accept);
+
+  _table = new QTableWidget(this);
+  _table->setColumnCount(3);
+  _table->setHorizontalHeaderLabels(QStringList() << "Kind"
+                                                  << "Name"
+                                                  << "Script");
+  QHeaderView *header = _table->horizontalHeader();
+  header->setSectionsMovable(false);
+  header->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+  header->setSectionResizeMode(1, QHeaderView::Stretch);
+  header->setSectionResizeMode(2, QHeaderView::ResizeToContents);
+  _table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  _table->setSelectionBehavior(QAbstractItemView::SelectRows);
+  _table->setSelectionMode(QAbstractItemView::SingleSelection);
+  _table->setFocusPolicy(Qt::NoFocus);
+  _table->verticalHeader()->setVisible(false);
+  connect(_table, &QTableWidget::itemDoubleClicked, this,
+          &GoToAnythingDialog::accept);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addWidget(_queryEdit);
+  layout->addWidget(_table);
+  setLayout(layout);
+
+  resize(700, 400);
+}
+
+bool GoToAnythingDialog::eventFilter(QObject *watched, QEvent *event) {
+  // move through the results without leaving the query box
+  if (watched == _queryEdit && event->type() == QEvent::KeyPress) {
+    int key = static_cast<QKeyEvent *>(event)->key();
+    if ((key == Qt::Key_Up || key == Qt::Key_Down) && _table->rowCount() > 0) {
+      int row = _table->currentRow() + (key == Qt::Key_Up ? -1 : 1);
+      _table->setCurrentCell(qBound(0, row, _table->rowCount() - 1), 0);
+      return true;
+    }
+  }
+  return QDialog::eventFilter(watched, event);
+}
+
+void GoToAnythingDialog::search(const QString &query) {
+  _table->setRowCount(0);
+  if (query.isEmpty()) return;
+
+  Project *project = dApp->project();
+  const FuzzyIndex &index = project->goToIndex();
+  auto hits = project->searchAnything(query, MaxHits);
+  _table->setRowCount((int)hits.size());
+  for (int i = 0; i < (int)hits.size(); i++) {
+    int entry = hits[i].entry;
+    QString kind, script;
+    switch ((GoToKind)index.kind(entry)) {
+      case GoToKind::File:
+        kind = "Script";
+        break;
+      case GoToKind::Label:
+        kind = "Label";
+        break;
+      case GoToKind::GlobalVar:
+        kind = "GlobalVar";
+        break;
+      case GoToKind::Flag:
+        kind = "Flag";
+        break;
+      case GoToKind::String:
+        kind = "Text";
+        break;
+    }
+    if (index.fileId(entry) >= 0 &&
+        (GoToKind)index.kind(entry) != GoToKind::File) {
+      script = QString::fromStdString(
+          project->files().at(index.fileId(entry))->getName());
+    }
+    auto col0 = new QTableWidgetItem(kind);
+    col0->setData(Qt::UserRole, entry);
+    _table->setItem(i, 0, col0);
+    _table->setItem(i, 1, new QTableWidgetItem(index.text(entry)));
+    _table->setItem(i, 2, new QTableWidgetItem(script));
+  }
+  if (!hits.empty()) _table->setCurrentCell(0, 0);
+}
+
+void GoToAnythingDialog::accept() {
+  int row = _table->currentRow();
+  if (row < 0) return;
+  int entry = _table->item(row, 0)->data(Qt::UserRole).toInt();
+  Project *project = dApp->project();
+  const FuzzyIndex &index = project->goToIndex();
+  int fileId = index.fileId(entry);
+  int id = index.id(entry);
+
+  switch ((GoToKind)index.kind(entry)) {
+    case GoToKind::File:
+      QDialog::accept();
+      project->switchFile(fileId);
+      break;
+    case GoToKind::Label:
+      QDialog::accept();
+      project->goToAddress(fileId,
+                           project->files().at(fileId)->getLabelOffset(id));
+      break;
+    case GoToKind::GlobalVar:
+    case GoToKind::Flag:
+      QDialog::accept();
+      project->focusMemory((GoToKind)index.kind(entry) == GoToKind::GlobalVar
+                               ? VariableRefType::GlobalVar
+                               : VariableRefType::Flag,
+                           id);
+      break;
+    case GoToKind::String: {
+      // strings nothing refers to only get their script opened
+      auto refs = project->getStringRefs(fileId, id);
+      QDialog::accept();
+      if (refs.empty())
+        project->switchFile(fileId);
+      else
+        project->goToAddress(refs.front().first, refs.front().second);
+      break;
+    }
+  }
+}
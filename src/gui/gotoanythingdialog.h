@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QDialog>
+#include <QLineEdit>
+#include <QTableWidget>
+
+// One box for jumping to a script, label, variable or string by fuzzy name.
+class GoToAnythingDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit GoToAnythingDialog(QWidget *parent = 0);
+
+ public slots:
+  void accept() override;
+
+ protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+ private slots:
+  void search(const QString &query);
+
+ private:
+  static const int MaxHits = 100;
+
+  QLineEdit *_queryEdit;
+  QTableWidget *_table;
+};
@@ -0,0 +1,102 @@
+#include "instructionsearchdialog.h"
+#include "debuggerapplication.h"
+#include "project.h"
+#include "textdump.h"
+#include "viewhelper.h"
+#include <QHeaderView>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <stdexcept>
+
+InstructionSearchDialog::InstructionSearchDialog(QWidget *parent)
+    : QDialog(parent) {
+  setWindowTitle("Find instructions");
+
+  _queryEdit = new QLineEdit(this);
+  _queryEdit->setPlaceholderText(
+      "e.g. If condition~Flags[1234], BGMplay track=12, Assign "
+      "writes:GlobalVars[*]");
+  connect(_queryEdit, &QLineEdit::returnPressed, this,
+          &InstructionSearchDialog::search);
+
+  _statusLabel = new QLabel(this);
+
+  _table = new QTableWidget(this);
+  _table->setColumnCount(2);
+  _table->setHorizontalHeaderLabels(QStringList() << "Location"
+                                                  << "Instruction");
+  QHeaderView *header = _table->horizontalHeader();
+  header->setSectionsMovable(false);
+  header->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+  header->setSectionResizeMode(1, QHeaderView::Stretch);
+  _table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  _table->setSelectionBehavior(QAbstractItemView::SelectRows);
+  _table->setSelectionMode(QAbstractItemView::SingleSelection);
+  _table->verticalHeader()->setVisible(false);
+  connect(_table, &QTableWidget::itemDoubleClicked, this,
+          &InstructionSearchDialog::accept);
+
+  // Enter runs the search, so only the buttons accept
+  _buttons =
+      new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+  _buttons->button(QDialogButtonBox::Ok)->setAutoDefault(false);
+  connect(_buttons, &QDialogButtonBox::accepted, this,
+          &InstructionSearchDialog::accept);
+  connect(_buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addWidget(_queryEdit);
+  layout->addWidget(_statusLabel);
+  layout->addWidget(_table);
+  layout->addWidget(_buttons);
+  setLayout(layout);
+
+  resize(800, 400);
+}
+
+void InstructionSearchDialog::search() {
+  _table->setRowCount(0);
+  _addresses.clear();
+
+  Project *project = dApp->project();
+  std::vector<SC3SearchHit> hits;
+  try {
+    hits = project->searchInstructions(_queryEdit->text());
+  } catch (const std::runtime_error &e) {
+    _statusLabel->setText(QString::fromStdString(e.what()));
+    return;
+  }
+
+  int rows = std::min((int)hits.size(), MaxRows);
+  if (rows < (int)hits.size())
+    _statusLabel->setText(QString("%1 results, showing the first %2")
+                              .arg(hits.size())
+                              .arg(rows));
+  else
+    _statusLabel->setText(QString("%1 results").arg(hits.size()));
+
+  _table->setRowCount(rows);
+  for (int i = 0; i < rows; i++) {
+    const auto &hit = hits[i];
+    SCXOffset address = hit.inst->position();
+    _addresses.emplace_back(hit.fileId, address);
+    _table->setItem(
+        i, 0,
+        new QTableWidgetItem(QString("%1@%2").arg(
+            QString::fromStdString(project->files().at(hit.fileId)->getName()),
+            displayTextForAddress(address))));
+    _table->setItem(i, 1,
+                    new QTableWidgetItem(QString::fromStdString(
+                        DumpSC3InstructionToText(
+                            false, project->contextProvider(), hit.fileId,
+                            hit.inst))));
+  }
+}
+
+void InstructionSearchDialog::accept() {
+  int row = _table->currentRow();
+  if (row < 0 || row >= (int)_addresses.size()) return;
+  QDialog::accept();
+  dApp->project()->goToAddress(_addresses[row].first, _addresses[row].second);
+}
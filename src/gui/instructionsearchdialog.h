@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QTableWidget>
+#include <parser/SCXTypes.h>
+#include <utility>
+#include <vector>
+
+class InstructionSearchDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit InstructionSearchDialog(QWidget *parent = 0);
+
+ public slots:
+  void accept() override;
+
+ private slots:
+  void search();
+
+ private:
+  // more would only make the table slow to fill
+  static const int MaxRows = 5000;
+
+  QLineEdit *_queryEdit;
+  QLabel *_statusLabel;
+  QTableWidget *_table;
+  QDialogButtonBox *_buttons;
+
+  std::vector<std::pair<int, SCXOffset>> _addresses;
+};
@@ -0,0 +1,79 @@
+#include "labellistmodel.h"
+#include "debuggerapplication.h"
+#include "project.h"
+#include <algorithm>
+
+LabelListModel::LabelListModel(int fileId, QObject *parent)
+    : QAbstractListModel(parent), _fileId(fileId), _renamedSinceFilter(false) {
+  _names = dApp->project()->getLabelNames(fileId);
+  _foldedNames.reserve(_names.size());
+  for (const QString &name : _names)
+    _foldedNames.push_back(name.toCaseFolded());
+
+  connect(dApp->project(), &Project::labelNameChanged, this,
+          &LabelListModel::onLabelNameChanged);
+}
+
+int LabelListModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  if (!_filter.isEmpty()) return (int)_visibleLabels.size();
+  return (int)_names.size();
+}
+
+int LabelListModel::labelIdForIndex(const QModelIndex &index) const {
+  if (!index.isValid() || index.row() >= rowCount()) return -1;
+  return _filter.isEmpty() ? index.row() : _visibleLabels[index.row()];
+}
+
+QVariant LabelListModel::data(const QModelIndex &index, int role) const {
+  if (role != Qt::DisplayRole) return QVariant();
+  int labelId = labelIdForIndex(index);
+  if (labelId < 0) return QVariant();
+  return QVariant(QString("#%1").arg(_names[labelId]));
+}
+
+void LabelListModel::setFilter(const QString &text) {
+  if (text == _filter) return;
+  QString folded = text.toCaseFolded();
+  bool narrowing = !_filter.isEmpty() && !_renamedSinceFilter &&
+                   folded.contains(_filter.toCaseFolded());
+
+  beginResetModel();
+  if (narrowing) {
+    _visibleLabels.erase(
+        std::remove_if(_visibleLabels.begin(), _visibleLabels.end(),
+                       [&](int labelId) {
+                         return !_foldedNames[labelId].contains(folded);
+                       }),
+        _visibleLabels.end());
+  } else {
+    _visibleLabels.clear();
+    if (!folded.isEmpty()) {
+      for (int i = 0; i < (int)_foldedNames.size(); i++) {
+        if (_foldedNames[i].contains(folded)) _visibleLabels.push_back(i);
+      }
+    }
+  }
+  _filter = text;
+  _renamedSinceFilter = false;
+  endResetModel();
+}
+
+void LabelListModel::onLabelNameChanged(int fileId, int labelId,
+                                        const QString &name) {
+  if (fileId != _fileId || labelId < 0 || labelId >= (int)_names.size())
+    return;
+  _names[labelId] = name;
+  _foldedNames[labelId] = name.toCaseFolded();
+
+  // renamed labels stay shown until the filter changes
+  int row = labelId;
+  if (!_filter.isEmpty()) {
+    _renamedSinceFilter = true;
+    auto it =
+        std::lower_bound(_visibleLabels.begin(), _visibleLabels.end(), labelId);
+    if (it == _visibleLabels.end() || *it != labelId) return;
+    row = it - _visibleLabels.begin();
+  }
+  emit dataChanged(index(row), index(row));
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <QAbstractListModel>
+#include <QString>
+#include <vector>
+
+// Labels of one script, "#name" per row. Names are fetched in one go and
+// kept up to date from labelNameChanged, so a model can be kept around and
+// shown again when switching back to its script.
+class LabelListModel : public QAbstractListModel {
+  Q_OBJECT
+
+ public:
+  explicit LabelListModel(int fileId, QObject *parent = 0);
+
+  int fileId() const { return _fileId; }
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+
+  // -1 for invalid indices
+  int labelIdForIndex(const QModelIndex &index) const;
+
+  // Case-insensitive substring filter on the name, empty shows all. Typing
+  // more of the same filter only rechecks the labels still shown.
+  void setFilter(const QString &text);
+  const QString &filter() const { return _filter; }
+
+ private slots:
+  void onLabelNameChanged(int fileId, int labelId, const QString &name);
+
+ private:
+  int _fileId;
+  std::vector<QString> _names;
+  std::vector<QString> _foldedNames;
+
+  QString _filter;
+  // label ids shown, only used while filtering
+  std::vector<int> _visibleLabels;
+  // a renamed label may match now, so the next filter starts over
+  bool _renamedSinceFilter;
+};
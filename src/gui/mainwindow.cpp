@@ -4,16 +4,26 @@
 #include "textdump.h"
 #include "project.h"
 #include "parser/SCXFile.h"
+#include <stdexcept>
 #include <vector>
 #include "disassemblymodel.h"
 #include "disassemblyview.h"
 #include <QDockWidget>
 #include <QInputDialog>
+#include <QFile>
 #include <QFileDialog>
+#include <QLineEdit>
 #include <QMessageBox>
+#include <QVBoxLayout>
 #include "memoryview.h"
+#include "labellistmodel.h"
 #include "worklistdialog.h"
 #include "newprojectdialog.h"
+#include "stringsearchdialog.h"
+#include "gotoanythingdialog.h"
+#include "instructionsearchdialog.h"
+#include "scriptdiffdialog.h"
+#include "parser/SC3DecodeStats.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow) {
@@ -48,18 +58,47 @@ MainWindow::MainWindow(QWidget *parent)
   labelListDock->setFeatures(labelListDock->features() &
                              ~QDockWidget::DockWidgetClosable);
   labelListDock->setAllowedAreas(Qt::AllDockWidgetAreas);
-  _labelList = new QListWidget(labelListDock);
-  labelListDock->setWidget(_labelList);
+  QWidget *labelPane = new QWidget(labelListDock);
+  QVBoxLayout *labelLayout = new QVBoxLayout(labelPane);
+  labelLayout->setContentsMargins(0, 0, 0, 0);
+  _labelFilter = new QLineEdit(labelPane);
+  _labelFilter->setPlaceholderText("Filter labels");
+  _labelFilter->setClearButtonEnabled(true);
+  labelLayout->addWidget(_labelFilter);
+  _labelList = new QListView(labelPane);
+  _labelList->setUniformItemSizes(true);
+  labelLayout->addWidget(_labelList);
+  labelListDock->setWidget(labelPane);
   splitDockWidget(fileListDock, labelListDock, Qt::Vertical);
-  connect(_labelList, &QListWidget::itemActivated,
-          [=]() { _disasmView->goToLabel(_labelList->currentRow()); });
+  connect(_labelList, &QListView::activated, [=](const QModelIndex &index) {
+    auto *labelModel = qobject_cast<LabelListModel *>(_labelList->model());
+    if (labelModel == nullptr) return;
+    int labelId = labelModel->labelIdForIndex(index);
+    if (labelId >= 0) _disasmView->goToLabel(labelId);
+  });
+  connect(_labelFilter, &QLineEdit::textChanged, [=](const QString &text) {
+    auto *labelModel = qobject_cast<LabelListModel *>(_labelList->model());
+    if (labelModel != nullptr) labelModel->setFilter(text);
+  });
 
   QDockWidget *memoryDock = new QDockWidget("Memory", this);
   memoryDock->setFeatures(memoryDock->features() &
                           ~QDockWidget::DockWidgetClosable);
   memoryDock->setAllowedAreas(Qt::AllDockWidgetAreas);
-  _memoryView = new MemoryView(this);
-  memoryDock->setWidget(_memoryView);
+  QWidget *memoryPane = new QWidget(memoryDock);
+  QVBoxLayout *memoryLayout = new QVBoxLayout(memoryPane);
+  memoryLayout->setContentsMargins(0, 0, 0, 0);
+  QLineEdit *memoryFilter = new QLineEdit(memoryPane);
+  memoryFilter->setPlaceholderText("Filter by name or comment");
+  memoryFilter->setClearButtonEnabled(true);
+  memoryLayout->addWidget(memoryFilter);
+  _memoryView = new MemoryView(memoryPane);
+  memoryLayout->addWidget(_memoryView);
+  memoryDock->setWidget(memoryPane);
+  connect(memoryFilter, &QLineEdit::textChanged, _memoryView,
+          &MemoryView::setFilter);
+  connect(_memoryView, &MemoryView::filterCleared, memoryFilter,
+          &QLineEdit::clear);
   splitDockWidget(disassemblyDock, memoryDock, Qt::Vertical);
 
   // without a centralwidget we need to fill *at least* the whole width or
@@ -70,6 +109,10 @@ MainWindow::MainWindow(QWidget *parent)
           &MainWindow::onProjectOpened);
   connect(dApp, &DebuggerApplication::projectClosed, this,
           &MainWindow::onProjectClosed);
+
+#ifndef SC3_DECODE_STATS
+  ui->actionExport_decode_statistics->setVisible(false);
+#endif
 }
 
 MainWindow::~MainWindow() { delete ui; }
@@ -77,8 +120,8 @@ MainWindow::~MainWindow() { delete ui; }
 void MainWindow::onProjectOpened() {
   connect(dApp->project(), &Project::fileSwitched, this,
           &MainWindow::onFileSwitched);
-  connect(dApp->project(), &Project::labelNameChanged, this,
-          &MainWindow::onLabelNameChanged);
+  connect(dApp->project(), &Project::disassemblyProgress, this,
+          &MainWindow::onDisassemblyProgress);
 
   const auto &files = dApp->project()->files();
   if (files.size() == 0) return;
@@ -95,7 +138,20 @@ void MainWindow::onProjectOpened() {
 
 void MainWindow::onProjectClosed() {
   _fileList->clear();
-  _labelList->clear();
+  _labelList->setModel(nullptr);
+  for (const auto &labelModel : _labelModels) delete labelModel.second;
+  _labelModels.clear();
+  ui->statusbar->clearMessage();
+}
+
+void MainWindow::onDisassemblyProgress(int done, int total) {
+  // queued from worker threads, may arrive after the project was closed
+  if (sender() != dApp->project()) return;
+  if (done < total)
+    ui->statusbar->showMessage(
+        QString("Disassembling scripts... %1/%2").arg(done).arg(total));
+  else
+    ui->statusbar->clearMessage();
 }
 
 void MainWindow::onFileSwitched(int previousId) {
@@ -117,23 +173,15 @@ void MainWindow::onFileSwitched(int previousId) {
             .arg(QString::fromStdString(currentFileName)));
   }
   {
-    const SCXFile *currentFile = dApp->project()->currentFile();
-    _labelList->clear();
-    for (int i = 0; i < currentFile->disassembly().size(); i++) {
-      _labelList->addItem(QString("#%1").arg(
-          dApp->project()->getLabelName(currentFile->getId(), i)));
-    }
+    int currentFileId = dApp->project()->currentFileId();
+    LabelListModel *&labelModel = _labelModels[currentFileId];
+    if (labelModel == nullptr)
+      labelModel = new LabelListModel(currentFileId, this);
+    labelModel->setFilter(_labelFilter->text());
+    _labelList->setModel(labelModel);
   }
 }
 
-void MainWindow::onLabelNameChanged(int fileId, int labelId,
-                                    const QString &name) {
-  if (fileId != dApp->project()->currentFileId()) return;
-  auto *item = _labelList->item(labelId);
-  if (item == nullptr) return;
-  item->setText(QString("#%1").arg(name));
-}
-
 void MainWindow::on_actionOpen_triggered() {
   QString fileName = QFileDialog::getOpenFileName(
       this, "Open project", QString(), "Project files (*.sqlite)");
@@ -155,6 +203,49 @@ void MainWindow::on_actionGo_to_address_triggered() {
   dApp->project()->goToAddress(dApp->project()->currentFileId(), address);
 }
 
+void MainWindow::on_actionGo_to_anything_triggered() {
+  if (dApp->project() == nullptr) return;
+  GoToAnythingDialog(this).exec();
+}
+
+void MainWindow::on_actionFind_text_triggered() {
+  if (dApp->project() == nullptr) return;
+  StringSearchDialog(this).exec();
+}
+
+void MainWindow::on_actionFind_instructions_triggered() {
+  if (dApp->project() == nullptr) return;
+  InstructionSearchDialog(this).exec();
+}
+
+void MainWindow::on_actionCompare_with_script_triggered() {
+  if (dApp->project() == nullptr || dApp->project()->currentFileId() < 0)
+    return;
+  QString fileName = QFileDialog::getOpenFileName(
+      this, "Compare with script", QString(), "Scripts (*.scx)");
+  if (fileName.isEmpty()) return;
+  try {
+    ScriptDiffDialog(dApp->project()->currentFileId(), fileName, this).exec();
+  } catch (const std::runtime_error &e) {
+    QMessageBox::critical(this, "Error", e.what());
+  }
+}
+
+void MainWindow::on_actionExport_decode_statistics_triggered() {
+#ifdef SC3_DECODE_STATS
+  QString fileName = QFileDialog::getSaveFileName(
+      this, "Export decode statistics", QString(), "Text files (*.txt)");
+  if (fileName.isEmpty()) return;
+  if (dApp->project() != nullptr) dApp->project()->waitForDisassembly();
+  QFile outFile(fileName);
+  if (!outFile.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+    QMessageBox::critical(this, "Error", "Could not write decode statistics");
+    return;
+  }
+  outFile.write(QByteArray::fromStdString(SC3DecodeStats::globalReport()));
+#endif
+}
+
 void MainWindow::on_actionEdit_stylesheet_triggered() {
   QString sheet = dApp->styleSheet();
   bool ok;
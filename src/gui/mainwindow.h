@@ -1,7 +1,10 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QListView>
 #include <QListWidget>
+#include <QLineEdit>
+#include <map>
 
 namespace Ui {
 class MainWindow;
@@ -9,6 +12,7 @@ class MainWindow;
 
 class DisassemblyView;
 class MemoryView;
+class LabelListModel;
 
 class MainWindow : public QMainWindow {
   Q_OBJECT
@@ -20,17 +24,25 @@ class MainWindow : public QMainWindow {
   Ui::MainWindow *ui;
   DisassemblyView *_disasmView;
   QListWidget *_fileList;
-  QListWidget *_labelList;
+  QListView *_labelList;
+  QLineEdit *_labelFilter;
+  // by fileId, created on first switch to the file
+  std::map<int, LabelListModel *> _labelModels;
   MemoryView *_memoryView;
 
  private slots:
   void onProjectOpened();
   void onProjectClosed();
   void onFileSwitched(int previousId);
-  void onLabelNameChanged(int fileId, int labelId, const QString &name);
+  void onDisassemblyProgress(int done, int total);
   void on_actionOpen_triggered();
   void on_actionClose_triggered();
   void on_actionGo_to_address_triggered();
+  void on_actionGo_to_anything_triggered();
+  void on_actionFind_text_triggered();
+  void on_actionFind_instructions_triggered();
+  void on_actionCompare_with_script_triggered();
+  void on_actionExport_decode_statistics_triggered();
   void on_actionEdit_stylesheet_triggered();
   void on_actionImport_worklist_triggered();
   void on_actionNew_project_triggered();
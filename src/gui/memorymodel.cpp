@@ -1,22 +1,44 @@
 #include "memorymodel.h"
 #include "debuggerapplication.h"
 #include "project.h"
+#include <algorithm>
+
+MemoryModel::MemoryModel(QObject *parent)
+    : QAbstractTableModel(parent), _indexDirty(true) {
+  _globalVarCount = dApp->project()->variableCount(VariableRefType::GlobalVar);
+  _flagCount = dApp->project()->variableCount(VariableRefType::Flag);
+  loadText();
 
-MemoryModel::MemoryModel(QObject *parent) : QAbstractTableModel(parent) {
   connect(dApp->project(), &Project::varNameChanged, this,
-          &MemoryModel::onVarTextChanged);
+          &MemoryModel::onVarNameChanged);
   connect(dApp->project(), &Project::varCommentChanged, this,
-          &MemoryModel::onVarTextChanged);
+          &MemoryModel::onVarCommentChanged);
   connect(dApp->project(), &Project::allVarsChanged, this,
           &MemoryModel::onAllVarsChanged);
 }
 
+void MemoryModel::loadText() {
+  int count = _globalVarCount + _flagCount;
+  _names.resize(count);
+  _comments.resize(count);
+  for (int row = 0; row < count; row++) {
+    VariableRefType type = row < _globalVarCount ? VariableRefType::GlobalVar
+                                                 : VariableRefType::Flag;
+    int var = row < _globalVarCount ? row : row - _globalVarCount;
+    _names[row] = dApp->project()->getVarName(type, var);
+    _comments[row] = dApp->project()->getVarComment(type, var);
+  }
+  _indexDirty = true;
+}
+
 int MemoryModel::columnCount(const QModelIndex &parent) const {
   return (int)ColumnType::NumColumns;
 }
 
 int MemoryModel::rowCount(const QModelIndex &parent) const {
-  return 8000 + 8000;
+  if (parent.isValid()) return 0;
+  if (!_filter.isEmpty()) return (int)_visibleRows.size();
+  return _globalVarCount + _flagCount;
 }
 
 QVariant MemoryModel::headerData(int section, Qt::Orientation orientation,
@@ -46,8 +68,8 @@ Qt::ItemFlags MemoryModel::flags(const QModelIndex &index) const {
 bool MemoryModel::setData(const QModelIndex &index, const QVariant &value,
                           int role) {
   if (index.isValid() && role == Qt::EditRole &&
-          ((ColumnType)index.column() == ColumnType::Name) ||
-      (ColumnType)index.column() == ColumnType::Comment) {
+      ((ColumnType)index.column() == ColumnType::Name ||
+       (ColumnType)index.column() == ColumnType::Comment)) {
     VariableRefType type;
     int var;
     std::tie(type, var) = varForIndex(index);
@@ -64,64 +86,151 @@ bool MemoryModel::setData(const QModelIndex &index, const QVariant &value,
 QVariant MemoryModel::data(const QModelIndex &index, int role) const {
   if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::EditRole))
     return QVariant();
-  VariableRefType varType;
-  int var;
-  std::tie(varType, var) = varForIndex(index);
-  if (var < 0) return QVariant();
+  int row = varRowForIndex(index);
+  if (row < 0) return QVariant();
   switch ((ColumnType)index.column()) {
     case ColumnType::VarType: {
-      switch (varType) {
-        case VariableRefType::GlobalVar:
-          return QVariant("GlobalVar");
-        case VariableRefType::Flag:
-          return QVariant("Flag");
-      }
-      break;
+      return QVariant(row < _globalVarCount ? "GlobalVar" : "Flag");
     }
     case ColumnType::Name: {
-      QString name = dApp->project()->getVarName(varType, var);
-      if (role == Qt::DisplayRole && name != QString("%1").arg(var)) {
+      const QString &name = _names[row];
+      int var = row < _globalVarCount ? row : row - _globalVarCount;
+      if (role == Qt::DisplayRole && name != QString::number(var)) {
         return QVariant(QString("%1 (%2)").arg(name).arg(var));
       }
       return QVariant(name);
-      break;
     }
     case ColumnType::Comment: {
-      return QVariant(dApp->project()->getVarComment(varType, var));
+      return QVariant(_comments[row]);
     }
     default:
       return QVariant();
   }
 }
 
-QModelIndex MemoryModel::indexForVar(VariableRefType type, int var) const {
-  if (var >= 8000 || var < 0 || (int)type < 0 ||
-      (int)type > (int)VariableRefType::Flag)
-    return QModelIndex();
+int MemoryModel::varRow(VariableRefType type, int var) const {
+  if (var < 0) return -1;
   if (type == VariableRefType::GlobalVar)
-    return createIndex(var, 0, nullptr);
-  else
-    return createIndex(var + 8000, 0, nullptr);
+    return var < _globalVarCount ? var : -1;
+  if (type == VariableRefType::Flag)
+    return var < _flagCount ? _globalVarCount + var : -1;
+  return -1;
+}
+
+int MemoryModel::varRowForIndex(const QModelIndex &index) const {
+  if (!index.isValid() || index.row() >= rowCount()) return -1;
+  return _filter.isEmpty() ? index.row() : _visibleRows[index.row()];
 }
+
+QModelIndex MemoryModel::indexForVar(VariableRefType type, int var) const {
+  int row = varRow(type, var);
+  if (row < 0) return QModelIndex();
+  if (_filter.isEmpty()) return index(row, 0);
+  auto it = std::find(_visibleRows.begin(), _visibleRows.end(), row);
+  if (it == _visibleRows.end()) return QModelIndex();
+  return index(it - _visibleRows.begin(), 0);
+}
+
 std::pair<VariableRefType, int> MemoryModel::varForIndex(
     const QModelIndex &index) const {
-  if (!index.isValid()) return std::make_pair(VariableRefType::GlobalVar, -1);
-  if (index.row() < 8000)
-    return std::make_pair(VariableRefType::GlobalVar, index.row());
+  int row = varRowForIndex(index);
+  if (row < 0) return std::make_pair(VariableRefType::GlobalVar, -1);
+  if (row < _globalVarCount)
+    return std::make_pair(VariableRefType::GlobalVar, row);
   else
-    return std::make_pair(VariableRefType::Flag, index.row() - 8000);
+    return std::make_pair(VariableRefType::Flag, row - _globalVarCount);
 }
 
-void MemoryModel::onVarTextChanged(VariableRefType type, int var,
-                                   const QString &text) {
-  QModelIndex origIndex = indexForVar(type, var);
-  QModelIndex endIndex =
-      createIndex(origIndex.row(), (int)ColumnType::NumColumns - 1,
-                  origIndex.internalPointer());
-  emit dataChanged(origIndex, endIndex);
+void MemoryModel::buildIndex() {
+  _sortedNames.clear();
+  _textIndex.clear();
+  _sortedNames.reserve(_names.size());
+  for (int row = 0; row < (int)_names.size(); row++) {
+    _sortedNames.emplace_back(_names[row].toCaseFolded(), row);
+    _textIndex.add(row, 0, _names[row]);
+    if (!_comments[row].isEmpty()) _textIndex.add(row, 1, _comments[row]);
+  }
+  std::sort(_sortedNames.begin(), _sortedNames.end());
+  _textIndex.build();
+  _indexDirty = false;
 }
 
-void MemoryModel::onAllVarsChanged() {
+void MemoryModel::applyFilter() {
+  _visibleRows.clear();
+  if (_filter.isEmpty()) return;
+  if (_indexDirty) buildIndex();
+
+  QString folded = _filter.toCaseFolded();
+  std::vector<bool> shown(_names.size(), false);
+
+  // names are sorted, so the ones starting with the filter are one range
+  auto first = std::lower_bound(_sortedNames.begin(), _sortedNames.end(),
+                                std::make_pair(folded, -1));
+  auto last = first;
+  while (last != _sortedNames.end() && last->first.startsWith(folded)) last++;
+  for (auto it = first; it != last; it++) {
+    _visibleRows.push_back(it->second);
+    shown[it->second] = true;
+  }
+  std::sort(_visibleRows.begin(), _visibleRows.end());
+
+  for (const auto &hit : _textIndex.search(_filter)) {
+    if (shown[hit.fileId]) continue;
+    _visibleRows.push_back(hit.fileId);
+    shown[hit.fileId] = true;
+  }
+}
+
+void MemoryModel::setFilter(const QString &text) {
+  if (text == _filter) return;
   beginResetModel();
+  _filter = text;
+  applyFilter();
   endResetModel();
-}
\ No newline at end of file
+}
+
+void MemoryModel::emitRowChanged(int varRow) {
+  if (_filter.isEmpty()) {
+    emit dataChanged(index(varRow, 0),
+                     index(varRow, (int)ColumnType::NumColumns - 1));
+    return;
+  }
+  // renamed rows stay where they are until the filter changes
+  for (int row = 0; row < (int)_visibleRows.size(); row++) {
+    if (_visibleRows[row] != varRow) continue;
+    emit dataChanged(index(row, 0),
+                     index(row, (int)ColumnType::NumColumns - 1));
+    return;
+  }
+}
+
+void MemoryModel::onVarNameChanged(VariableRefType type, int var,
+                                   const QString &name) {
+  int row = varRow(type, var);
+  if (row < 0) return;
+  _names[row] = dApp->project()->getVarName(type, var);
+  _indexDirty = true;
+  emitRowChanged(row);
+}
+
+void MemoryModel::onVarCommentChanged(VariableRefType type, int var,
+                                      const QString &comment) {
+  int row = varRow(type, var);
+  if (row < 0) return;
+  _comments[row] = comment;
+  _indexDirty = true;
+  emitRowChanged(row);
+}
+
+void MemoryModel::onAllVarsChanged() {
+  loadText();
+  if (!_filter.isEmpty()) {
+    beginResetModel();
+    applyFilter();
+    endResetModel();
+    return;
+  }
+  if (rowCount() == 0) return;
+  emit dataChanged(index(0, 0),
+                   index(rowCount() - 1, (int)ColumnType::NumColumns - 1));
+}
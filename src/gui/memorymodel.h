@@ -2,8 +2,14 @@
 #include <QAbstractTableModel>
 #include <QString>
 #include "enums.h"
+#include "stringindex.h"
 #include <utility>
+#include <vector>
 
+// GlobalVars followed by Flags. Names and comments are copied out of the
+// project once and kept up to date from its signals, so painting never goes
+// back to the project. An optional filter narrows the rows down without a
+// proxy model.
 class MemoryModel : public QAbstractTableModel {
   Q_OBJECT
 
@@ -22,10 +28,44 @@ class MemoryModel : public QAbstractTableModel {
   bool setData(const QModelIndex &index, const QVariant &value,
                int role = Qt::EditRole) override;
 
+  // invalid if the variable is filtered out
   QModelIndex indexForVar(VariableRefType type, int var) const;
   std::pair<VariableRefType, int> varForIndex(const QModelIndex &index) const;
 
+  // Case-insensitive: variables whose name starts with the text come first,
+  // then those with it anywhere in their name or comment. Empty shows all.
+  void setFilter(const QString &text);
+  const QString &filter() const { return _filter; }
+
  private slots:
-  void onVarTextChanged(VariableRefType type, int var, const QString &text);
+  void onVarNameChanged(VariableRefType type, int var, const QString &name);
+  void onVarCommentChanged(VariableRefType type, int var,
+                           const QString &comment);
   void onAllVarsChanged();
-};
\ No newline at end of file
+
+ private:
+  int _globalVarCount;
+  int _flagCount;
+
+  // by variable row (GlobalVars, then Flags)
+  std::vector<QString> _names;
+  std::vector<QString> _comments;
+
+  QString _filter;
+  // variable rows shown, only used while filtering
+  std::vector<int> _visibleRows;
+
+  // built when a filter is first set after the text changed
+  bool _indexDirty;
+  // case folded name, variable row
+  std::vector<std::pair<QString, int>> _sortedNames;
+  // fileId = variable row, stringId = 0 for the name, 1 for the comment
+  StringIndex _textIndex;
+
+  void loadText();
+  void buildIndex();
+  void applyFilter();
+  int varRow(VariableRefType type, int var) const;
+  int varRowForIndex(const QModelIndex &index) const;
+  void emitRowChanged(int varRow);
+};
@@ -43,11 +43,22 @@ void MemoryView::goToVar(VariableRefType type, int var) {
   if (memModel == nullptr) return;
 
   QModelIndex index = memModel->indexForVar(type, var);
+  if (!index.isValid() && !memModel->filter().isEmpty()) {
+    setFilter(QString());
+    emit filterCleared();
+    index = memModel->indexForVar(type, var);
+  }
   setCurrentIndex(index);
   // in case the line was already selected, still scroll there
   scrollTo(index);
 }
 
+void MemoryView::setFilter(const QString& text) {
+  MemoryModel* memModel = qobject_cast<MemoryModel*>(model());
+  if (memModel == nullptr) return;
+  memModel->setFilter(text);
+}
+
 void MemoryView::onProjectOpened() {
   connect(dApp->project(), &Project::focusMemorySwitched, this,
           &MemoryView::goToVar);
@@ -55,12 +66,14 @@ void MemoryView::onProjectOpened() {
   QAbstractItemModel* oldModel = model();
   setModel(new MemoryModel());
   if (oldModel != nullptr) delete oldModel;
+  emit filterCleared();
 }
 
 void MemoryView::onProjectClosed() {
   QAbstractItemModel* oldModel = model();
   setModel(nullptr);
   if (oldModel != nullptr) delete oldModel;
+  emit filterCleared();
 }
 
 void MemoryView::onXrefKeyPress() {
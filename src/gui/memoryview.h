@@ -10,6 +10,11 @@ class MemoryView : public QTableView {
 
  public slots:
   void goToVar(VariableRefType type, int var);
+  void setFilter(const QString &text);
+
+ signals:
+  // the filter was dropped to show a variable, or with the model
+  void filterCleared();
 
  private slots:
   void onXrefKeyPress();
@@ -1,15 +1,23 @@
 #include "project.h"
+#include <parser/MPKArchive.h>
 #include <parser/SC3BaseDisassembler.h>
 #include <parser/SC3CodeBlock.h>
 #include <parser/SC3Instruction.h>
 #include <parser/SC3StringDecoder.h>
 #include <QFile>
 #include <QDirIterator>
+#include <QFileInfo>
+#include <QStandardPaths>
 #include <QStringList>
 #include <QTextStream>
-#include <QRegExp>
+#include <QRegularExpression>
+#include <algorithm>
 #include <stdexcept>
+#include <tuple>
 #include "analysis.h"
+#include "backgrounddisassembler.h"
+#include "projectwriter.h"
+#include "scriptstore.h"
 
 // create new database
 Project::Project(const QString& dbPath, const QString& loadPath,
@@ -18,7 +26,8 @@ Project::Project(const QString& dbPath, const QString& loadPath,
   createDatabase(dbPath);
 
   std::vector<TmpFileData> files;
-  if (!importMpk(loadPath, files)) {
+  std::unique_ptr<MPKArchive> mpk;
+  if (!importMpk(loadPath, files, mpk)) {
     for (const auto& file : files) {
       free(file.data);
     }
@@ -31,24 +40,40 @@ Project::Project(const QString& dbPath, const QString& loadPath,
     }
   }
 
+  // nothing to lose if the import dies halfway, so skip the journal
+  QSqlQuery pragma(_db);
+  pragma.exec("PRAGMA journal_mode = OFF");
+  pragma.exec("PRAGMA synchronous = OFF");
+
   _db.transaction();
 
   setGameId(game->id());
 
-  for (const auto& file : files) {
+  for (size_t i = 0; i < files.size(); i++) {
+    TmpFileData& file = files[i];
+    if (file.data == nullptr) file.data = mpk->extractEntry(file.archiveIndex);
+    if (file.data == nullptr) {
+      // the ones already inserted belong to their SCXFile
+      for (size_t j = i + 1; j < files.size(); j++) free(files[j].data);
+      throw std::runtime_error("Couldn't read input");
+    }
     insertFile(file.name, file.data, file.size, file.id);
   }
-
-  for (int globalVar = 0; globalVar < 8000; globalVar++) {
-    insertVariable(VariableRefType::GlobalVar, globalVar,
-                   QString("%1").arg(globalVar));
-  }
-  // TODO: recheck if 8000 is the max
-  for (int flag = 0; flag < 8000; flag++) {
-    insertVariable(VariableRefType::Flag, flag, QString("%1").arg(flag));
-  }
+  // needs every script's ScriptLoads
+  storeScannedRefs(true, true);
+  setKey("stringRefsScanned", 1);
   _db.commit();
 
+  pragma.exec("PRAGMA journal_mode = DELETE");
+  pragma.exec("PRAGMA synchronous = FULL");
+
+  createIndexes();
+  _xrefIndex.build();
+  _callGraph.build();
+  _stringIndex.build();
+
+  _writer.reset(new ProjectWriter(dbPath));
+
   _inInitialLoad = false;
 }
 
@@ -56,62 +81,96 @@ Project::Project(const QString& dbPath, const QString& loadPath,
 Project::Project(const QString& dbPath, QObject* parent = 0)
     : QObject(parent), _contextProvider(this) {
   openDatabase(dbPath);
+  migrateFilesToScriptStore();
+  createRefTables();
   prepareStmts();
 
   _game = SupportedGames[getGameId()];
 
   loadFilesFromDb();
+  // projects from before the indexes existed
+  createIndexes();
+  // projects from before variables were stored sparsely
+  pruneDefaultVariables();
+  loadXrefIndexFromDb();
+  loadNamesFromDb();
+  loadCommentsFromDb();
+  loadStringsFromDb();
+
+  _writer.reset(new ProjectWriter(dbPath));
+
+  // projects from before far/string refs and calls were indexed get them
+  // once everything is disassembled
+  if (!hasKey("farRefsScanned") || !hasKey("callRefsScanned") ||
+      !hasKey("stringRefsScanned")) {
+    connect(this, &Project::disassemblyProgress, this,
+            [this](int done, int total) {
+              if (done == total) scanMissingRefs();
+            });
+  }
+
+  // everything above comes straight from the DB, so the project is usable
+  // while the files are being disassembled
+  std::vector<SCXFile*> files;
+  for (const auto& file : _files) {
+    files.push_back(file.second.get());
+    // filled in by the workers, which must not insert
+    _controlFlowGraphs[file.first];
+  }
+  _disassembler.reset(new BackgroundDisassembler(
+      _game, files,
+      [this](const SCXFile* file) {
+        _controlFlowGraphs.at(file->getId()) = BuildSC3ControlFlowGraph(file);
+      },
+      [this](int fileId, int done, int total) {
+        // queued to the GUI thread when called from a worker
+        emit fileDisassembled(fileId);
+        emit disassemblyProgress(done, total);
+      }));
 
   _inInitialLoad = false;
 }
 
 Project::~Project() {
-  if (_db.isOpen()) _db.close();
+  // workers still hold pointers into _files
+  _disassembler.reset();
+  // flushes pending edits
+  _writer.reset();
+  if (!_db.isOpen()) return;
+  // SQLite only leaves WAL mode from the last open connection, which this is
+  // now. Back to a single file, so projects can be copied around
+  QSqlQuery pragma(_db);
+  if (!pragma.exec("PRAGMA journal_mode = DELETE") || !pragma.next() ||
+      pragma.value(0).toString().compare("delete", Qt::CaseInsensitive) != 0)
+    qWarning("Couldn't leave WAL mode: %s",
+             qPrintable(pragma.lastError().text()));
+  pragma.finish();
+  _db.close();
 }
 
 bool Project::importMpk(const QString& mpkPath,
-                        std::vector<TmpFileData>& files) {
-  QFile mpk(mpkPath);
-  if (!mpk.open(QIODevice::ReadOnly)) {
+                        std::vector<TmpFileData>& files,
+                        std::unique_ptr<MPKArchive>& archive) {
+  try {
+    archive.reset(new MPKArchive(QFile::encodeName(mpkPath).toStdString()));
+  } catch (const std::runtime_error&) {
     return false;
   }
-  QByteArray magic = mpk.read(4);
-  if (magic != QByteArrayLiteral("MPK\0")) return false;
-  uint16_t versionMinor;
-  uint16_t versionMajor;
-  mpk.read((char*)&versionMinor, 2);
-  mpk.read((char*)&versionMajor, 2);
-  if (qFromLittleEndian(versionMinor) != 0 ||
-      qFromLittleEndian(versionMajor) != 2)
-    return false;
-  int fileCount;
-  mpk.read((char*)&fileCount, 4);
-  fileCount = qFromLittleEndian(fileCount);
-  for (int i = 0; i < fileCount; i++) {
+  QString cacheDir =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/mpk";
+  if (QDir().mkpath(cacheDir))
+    archive->setCacheDirectory(QFile::encodeName(cacheDir).toStdString());
+
+  const auto& entries = archive->entries();
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (entries[i].uncompressedSize > INT_MAX) return false;
+    // extracted (and inflated) when the file gets inserted
     TmpFileData file;
-    mpk.seek(0x40 + 0x100 * i);
-    int compression;
-    mpk.read((char*)&compression, 4);
-    if (compression != 0) return false;
-    mpk.read((char*)&file.id, 4);
-    file.id = qFromLittleEndian(file.id);
-    qint64 dataOffset;
-    mpk.read((char*)&dataOffset, 8);
-    dataOffset = qFromLittleEndian(dataOffset);
-    qint64 dataSize;
-    mpk.read((char*)&dataSize, 8);
-    dataSize = qFromLittleEndian(dataSize);
-    mpk.seek(mpk.pos() + 8);  // compressed == uncompressed
-    if (dataSize > INT_MAX) return false;
-    file.size = (int)dataSize;
-    QByteArray name = mpk.read(0xE0);
-    file.name = QString(name);
-    mpk.seek(dataOffset);
-    file.data = (uint8_t*)malloc(file.size);
-    if (mpk.read((char*)file.data, file.size) < file.size) {
-      free(file.data);
-      return false;
-    }
+    file.id = entries[i].id;
+    file.name = QString::fromStdString(entries[i].name);
+    file.size = (int)entries[i].uncompressedSize;
+    file.data = nullptr;
+    file.archiveIndex = i;
     files.push_back(file);
   }
   return true;
@@ -160,8 +219,22 @@ const SCXFile* Project::currentFile() const {
   return _files.at(_currentFileId).get();
 }
 
+bool Project::isDisassembled(int fileId) const {
+  return _disassembler == nullptr || _disassembler->isDisassembled(fileId);
+}
+
+void Project::ensureDisassembled(int fileId) {
+  if (_disassembler != nullptr) _disassembler->ensureDisassembled(fileId);
+}
+
+void Project::waitForDisassembly() {
+  if (_disassembler != nullptr) _disassembler->waitForAll();
+}
+
 void Project::switchFile(int id) {
   if (id >= 0 && _currentFileId != id && _files.count(id) > 0) {
+    // jumps the queue if the workers haven't gotten to it yet
+    ensureDisassembled(id);
     int previousId = _currentFileId;
     _currentFileId = id;
     emit fileSwitched(previousId);
@@ -178,80 +251,134 @@ void Project::focusMemory(VariableRefType type, int var) {
 }
 
 QString Project::getComment(int fileId, SCXOffset address) {
-  _getCommentQuery.addBindValue(fileId);
-  _getCommentQuery.addBindValue(address);
-  _getCommentQuery.exec();
-  _getCommentQuery.next();
-
-  QString result;
-  if (_getCommentQuery.isValid()) {
-    result = QString::fromUtf8(_getCommentQuery.value(0).toByteArray());
-  }
+  auto fileComments = _comments.find(fileId);
+  if (fileComments == _comments.end()) return QString();
+  auto comment = fileComments->second.find(address);
+  if (comment == fileComments->second.end()) return QString();
+  return comment->second;
+}
 
-  return result;
+const std::map<SCXOffset, QString>& Project::getComments(int fileId) {
+  static const std::map<SCXOffset, QString> noComments;
+  auto fileComments = _comments.find(fileId);
+  if (fileComments == _comments.end()) return noComments;
+  return fileComments->second;
 }
 
 void Project::setComment(int fileId, SCXOffset address,
                          const QString& comment) {
-  _setCommentQuery.addBindValue(fileId);
-  _setCommentQuery.addBindValue(address);
-  _setCommentQuery.addBindValue(comment.toUtf8());
-  _setCommentQuery.exec();
+  if (comment.isEmpty())
+    _comments[fileId].erase(address);
+  else
+    _comments[fileId][address] = comment;
+
+  _writer->setComment(fileId, address, comment);
 
   emit commentChanged(fileId, address, comment);
 }
 
+void Project::loadCommentsFromDb() {
+  _comments.clear();
+  _getAllCommentsQuery.exec();
+  while (_getAllCommentsQuery.next()) {
+    QString text =
+        QString::fromUtf8(_getAllCommentsQuery.value(2).toByteArray());
+    if (text.isEmpty()) continue;
+    _comments[_getAllCommentsQuery.value(0).toInt()]
+             [_getAllCommentsQuery.value(1).toInt()] = text;
+  }
+}
+
+// TODO: still not quite the right place
+static QString defaultLabelName(const SCXFile* file, int labelId) {
+  return QString("label%1_%2")
+      .arg(labelId)
+      .arg(file->getLabelOffset(labelId));
+}
+
 QString Project::getLabelName(int fileId, int labelId) {
   if (fileId < 0 || _files.count(fileId) == 0) return "";
   const SCXFile* file = _files.at(fileId).get();
-  if (labelId < 0 || labelId >= file->disassembly().size()) return "";
-  _getLabelNameQuery.addBindValue(fileId);
-  _getLabelNameQuery.addBindValue(labelId);
-  _getLabelNameQuery.exec();
-  _getLabelNameQuery.next();
-
-  QString result;
-  if (_getLabelNameQuery.isValid()) {
-    result = QString::fromUtf8(_getLabelNameQuery.value(0).toByteArray());
-  }
+  // only the label table, since the file may not be disassembled yet
+  if (labelId < 0 || labelId >= file->getLabelCount()) return "";
 
-  // TODO: still not quite the right place
-  if (result.isEmpty()) {
-    return QString("label%1_%2")
-        .arg(labelId)
-        .arg(file->disassembly()[labelId]->address());
+  auto fileNames = _labelNames.find(fileId);
+  if (fileNames != _labelNames.end()) {
+    auto name = fileNames->second.find(labelId);
+    if (name != fileNames->second.end()) return name->second;
   }
 
-  return result;
+  return defaultLabelName(file, labelId);
 }
 
 void Project::setLabelName(int fileId, int labelId, const QString& name) {
-  _setLabelNameQuery.addBindValue(fileId);
-  _setLabelNameQuery.addBindValue(labelId);
-  _setLabelNameQuery.addBindValue(name.toUtf8());
-  _setLabelNameQuery.exec();
+  if (name.isEmpty())
+    _labelNames[fileId].erase(labelId);
+  else
+    _labelNames[fileId][labelId] = name;
+
+  _writer->setLabelName(fileId, labelId, name);
+  auto goToStart = _goToLabelStart.find(fileId);
+  if (_goToIndexBuilt && goToStart != _goToLabelStart.end() && labelId >= 0 &&
+      labelId < _files.at(fileId)->getLabelCount())
+    _goToIndex.setText(goToStart->second + labelId,
+                       getLabelName(fileId, labelId));
 
   // ugly, but we want to return the fallback if name was empty
   emit labelNameChanged(fileId, labelId, getLabelName(fileId, labelId));
 }
 
+std::vector<QString> Project::getLabelNames(int fileId) {
+  std::vector<QString> result;
+  if (fileId < 0 || _files.count(fileId) == 0) return result;
+  const SCXFile* file = _files.at(fileId).get();
+  result.reserve(file->getLabelCount());
+  for (int i = 0; i < file->getLabelCount(); i++)
+    result.push_back(defaultLabelName(file, i));
+
+  auto fileNames = _labelNames.find(fileId);
+  if (fileNames == _labelNames.end()) return result;
+  for (const auto& name : fileNames->second) {
+    if (name.first >= 0 && name.first < (int)result.size())
+      result[name.first] = name.second;
+  }
+  return result;
+}
+
 QString Project::getVarName(VariableRefType type, int var) {
-  QVariant vtype;
-  vtype.setValue(type);
-  _getVarNameQuery.addBindValue(vtype);
-  _getVarNameQuery.addBindValue(var);
-  _getVarNameQuery.exec();
-  _getVarNameQuery.next();
+  const auto& names = _varNames[(int)type];
+  if (var >= 0 && var < (int)names.size() && !names[var].isEmpty()) {
+    return names[var];
+  }
+  return QString("%1").arg(var);
+}
 
-  QString result;
-  if (_getVarNameQuery.isValid()) {
-    result = QString::fromUtf8(_getVarNameQuery.value(0).toByteArray());
+int Project::variableCount(VariableRefType type) const {
+  return type == VariableRefType::GlobalVar ? _game->globalVarCount()
+                                            : _game->flagCount();
+}
+
+// Only named or commented variables are stored, everything else gets its
+// number as a name.
+void Project::cacheVarName(VariableRefType type, int var,
+                           const QString& name) {
+  auto& names = _varNames[(int)type];
+  auto& ids = _varIdsByName[(int)type];
+  if (var < 0) return;
+  if (name == QString::number(var)) {
+    if (var >= (int)names.size()) return;
+    cacheVarName(type, var, QString());
+    return;
   }
-  if (result.isEmpty()) {
-    return QString("%1").arg(var);
+  if (var >= (int)names.size()) names.resize(var + 1);
+  if (!names[var].isEmpty()) {
+    auto it = ids.find(names[var]);
+    if (it != ids.end() && it.value() == var) ids.erase(it);
   }
-  return result;
+  names[var] = name;
+  if (!name.isEmpty()) ids.insert(name, var);
 }
+
 void Project::setVarName(const QString& name, VariableRefType type, int var) {
   QString outName = name;
   int existingId = getVariableId(type, name);
@@ -259,12 +386,10 @@ void Project::setVarName(const QString& name, VariableRefType type, int var) {
   if (existingId == var) return;
   if (existingId >= 0) outName.append(QString("_%1").arg(var));
 
-  _setVarNameQuery.addBindValue(outName.toUtf8());
-  QVariant vtype;
-  vtype.setValue(type);
-  _setVarNameQuery.addBindValue(vtype);
-  _setVarNameQuery.addBindValue(var);
-  _setVarNameQuery.exec();
+  cacheVarName(type, var, outName);
+  persistVariable(type, var);
+  if (_goToIndexBuilt && var >= 0 && var < variableCount(type))
+    _goToIndex.setText(_goToVarStart[(int)type] + var, getVarName(type, var));
 
   if (!_batchUpdatingVars) {
     emit varNameChanged(type, var, getVarName(type, var));
@@ -272,27 +397,17 @@ void Project::setVarName(const QString& name, VariableRefType type, int var) {
 }
 
 QString Project::getVarComment(VariableRefType type, int var) {
-  QVariant vtype;
-  vtype.setValue(type);
-  _getVarCommentQuery.addBindValue(vtype);
-  _getVarCommentQuery.addBindValue(var);
-  _getVarCommentQuery.exec();
-  _getVarCommentQuery.next();
-
-  QString result;
-  if (_getVarCommentQuery.isValid()) {
-    result = QString::fromUtf8(_getVarCommentQuery.value(0).toByteArray());
-  }
-  return result;
+  const auto& comments = _varComments[(int)type];
+  if (var < 0 || var >= (int)comments.size()) return QString();
+  return comments[var];
 }
 void Project::setVarComment(const QString& comment, VariableRefType type,
                             int var) {
-  _setVarCommentQuery.addBindValue(comment.toUtf8());
-  QVariant vtype;
-  vtype.setValue(type);
-  _setVarCommentQuery.addBindValue(vtype);
-  _setVarCommentQuery.addBindValue(var);
-  _setVarCommentQuery.exec();
+  if (var < 0) return;
+  auto& comments = _varComments[(int)type];
+  if (var >= (int)comments.size()) comments.resize(var + 1);
+  comments[var] = comment;
+  persistVariable(type, var);
 
   if (!_batchUpdatingVars) {
     emit varCommentChanged(type, var, comment);
@@ -320,8 +435,6 @@ int Project::getStringCount(int fileId) {
 void Project::analyzeFile(const SCXFile* file) {
   int fileId = file->getId();
 
-  // TODO: batch inserts?
-  // probably not necessary because of the transaction
   for (const auto& label : file->disassembly()) {
     for (const auto& inst : label->instructions()) {
       const SC3Instruction* instruction = inst.get();
@@ -332,46 +445,85 @@ void Project::analyzeFile(const SCXFile* file) {
 
       for (const auto& ref : varRefs) {
         insertVariableRef(fileId, inst->position(), ref.first, ref.second);
+        _xrefIndex.addVariableRef(ref.first, ref.second, fileId,
+                                  inst->position());
       }
       for (const auto& ref : localLabelRefs) {
         insertLocalLabelRef(fileId, inst->position(), ref);
+        _xrefIndex.addLabelRef(fileId, ref, inst->position());
       }
     }
   }
+  flushVariableRefs();
+  flushLocalLabelRefs();
+  collectFarRefs(file);
+  insertStringRefs(file);
 
   SC3StringDecoder strdec(*file, _game->charset());
   const std::vector<std::string> stringTable = strdec.decodeStringTableToUtf8();
 
   int stringId = 0;
   for (const auto& string : stringTable) {
+    _stringIndex.add(fileId, stringId, QString::fromStdString(string));
     insertString(file->getId(), stringId++, string);
   }
 }
 
+void Project::insertStringRefs(const SCXFile* file) {
+  int fileId = file->getId();
+  QVariantList fileIds, addresses, stringIds;
+  for (const auto& label : file->disassembly()) {
+    for (const auto& inst : label->instructions()) {
+      for (int stringId : stringRefsInInstruction(inst.get())) {
+        fileIds << fileId;
+        addresses << inst->position();
+        stringIds << stringId;
+        _xrefIndex.addStringRef(fileId, stringId, inst->position());
+      }
+    }
+  }
+  if (fileIds.isEmpty()) return;
+  _insertStringRefQuery.addBindValue(fileIds);
+  _insertStringRefQuery.addBindValue(addresses);
+  _insertStringRefQuery.addBindValue(stringIds);
+  _insertStringRefQuery.execBatch();
+}
+
+void Project::loadStringsFromDb() {
+  _stringIndex.clear();
+  QSqlQuery q(_db);
+  q.setForwardOnly(true);
+  q.exec("SELECT fileId, stringId, text FROM strings");
+  while (q.next()) {
+    _stringIndex.add(q.value(0).toInt(), q.value(1).toInt(),
+                     QString::fromUtf8(q.value(2).toByteArray()));
+  }
+  _stringIndex.build();
+}
+
 void Project::loadFilesFromDb() {
   _getFilesQuery.exec();
 
-  std::vector<std::pair<int, SCXOffset>> result;
   while (_getFilesQuery.next()) {
     int id = _getFilesQuery.value(0).toInt();
     std::string name = _getFilesQuery.value(1).toByteArray().toStdString();
-    QByteArray bdata = _getFilesQuery.value(2).toByteArray();
-    uint8_t* data = (uint8_t*)malloc(bdata.size());
-    memcpy(data, bdata.constData(), bdata.size());
-
-    std::unique_ptr<SCXFile> scxFile =
-        std::unique_ptr<SCXFile>(new SCXFile(data, bdata.size(), name, id));
-    SC3BaseDisassembler* dis = _game->createDisassembler(*scxFile);
-    dis->DisassembleFile();
-
-    _files[id] = std::move(scxFile);
+    QString hash = _getFilesQuery.value(2).toString();
+    uint8_t* data;
+    int size;
+    std::shared_ptr<QFile> mapping = _scriptStore->map(hash, &data, &size);
+    if (mapping == nullptr) {
+      throw std::runtime_error("Missing script " + name + " (" +
+                               hash.toStdString() + ")");
+    }
 
-    delete dis;
+    // disassembled later by _disassembler
+    _files[id] = std::unique_ptr<SCXFile>(
+        new SCXFile(data, size, name, id, std::move(mapping)));
   }
 }
 
 void Project::insertFile(const QString& name, uint8_t* data, int size, int id) {
-  QVariant vdata(QByteArray::fromRawData((char*)data, size));
+  QString hash = _scriptStore->put(data, size);
 
   std::unique_ptr<SCXFile> scxFile =
       std::unique_ptr<SCXFile>(new SCXFile(data, size, name.toStdString(), id));
@@ -379,75 +531,404 @@ void Project::insertFile(const QString& name, uint8_t* data, int size, int id) {
   dis->DisassembleFile();
 
   analyzeFile(scxFile.get());
+  _controlFlowGraphs[id] = BuildSC3ControlFlowGraph(scxFile.get());
 
   _files[id] = std::move(scxFile);
 
   _insertFileQuery.addBindValue(id);
   _insertFileQuery.addBindValue(name.toUtf8());
-  _insertFileQuery.addBindValue(vdata);
+  _insertFileQuery.addBindValue(hash);
   _insertFileQuery.exec();
 
   delete dis;
 }
 
-void Project::insertVariable(VariableRefType type, int var,
-                             const QString& name) {
-  QVariant vtype;
-  vtype.setValue(type);
-  _insertVariableQuery.addBindValue(vtype);
-  _insertVariableQuery.addBindValue(var);
-  _insertVariableQuery.addBindValue(name);
-  _insertVariableQuery.exec();
+// Projects from before the script store kept scripts in files.data. Move them
+// out once, leaving empty blobs behind.
+void Project::migrateFilesToScriptStore() {
+  if (_db.record("files").contains("hash")) return;
+
+  _db.transaction();
+  QSqlQuery q(_db);
+  q.exec("ALTER TABLE files ADD COLUMN hash TEXT");
+  QSqlQuery select(_db);
+  select.setForwardOnly(true);
+  select.exec("SELECT id, data FROM files");
+  QSqlQuery update(_db);
+  update.prepare("UPDATE files SET hash = ?, data = zeroblob(0) WHERE id = ?");
+  while (select.next()) {
+    QByteArray data = select.value(1).toByteArray();
+    update.addBindValue(
+        _scriptStore->put((const uint8_t*)data.constData(), data.size()));
+    update.addBindValue(select.value(0).toInt());
+    update.exec();
+  }
+  _db.commit();
+  q.exec("VACUUM");
 }
 
 std::vector<std::pair<int, SCXOffset>> Project::getVariableRefs(
     VariableRefType type, int var) {
-  QVariant vtype;
-  vtype.setValue(type);
-  _getVariableRefsQuery.addBindValue(vtype);
-  _getVariableRefsQuery.addBindValue(var);
-  _getVariableRefsQuery.exec();
+  return _xrefIndex.variableRefs(type, var);
+}
+
+std::vector<std::pair<int, SCXOffset>> Project::getLabelRefs(int fileId,
+                                                             int labelId) {
+  return _xrefIndex.labelRefs(fileId, labelId);
+}
+
+std::vector<std::pair<int, SCXOffset>> Project::getScriptLoadRefs(
+    int fileId) {
+  return _xrefIndex.scriptLoadRefs(fileId);
+}
 
-  std::vector<std::pair<int, SCXOffset>> result;
-  while (_getVariableRefsQuery.next()) {
-    result.emplace_back(_getVariableRefsQuery.value(0).toInt(),
-                        _getVariableRefsQuery.value(1).toInt());
+std::vector<std::pair<int, SCXOffset>> Project::getStringRefs(int fileId,
+                                                              int stringId) {
+  return _xrefIndex.stringRefs(fileId, stringId);
+}
+
+std::vector<StringIndex::Hit> Project::searchStrings(const QString& query,
+                                                     int maxHits) {
+  return _stringIndex.search(query, maxHits);
+}
+
+std::vector<SC3SearchHit> Project::searchInstructions(const QString& query) {
+  SC3InstructionQuery parsed = SC3InstructionQuery::parse(query.toStdString());
+  if (_instructionSearch == nullptr) {
+    waitForDisassembly();
+    std::vector<const SCXFile*> files;
+    for (const auto& file : _files) files.push_back(file.second.get());
+    _instructionSearch.reset(new SC3InstructionSearch(files));
   }
+  return _instructionSearch->find(parsed);
+}
 
-  return result;
+void Project::buildGoToIndex() {
+  _goToIndex.clear();
+  _goToLabelStart.clear();
+  for (const auto& file : _files) {
+    _goToIndex.add((int)GoToKind::File, file.first, file.first,
+                   QString::fromStdString(file.second->getName()));
+  }
+  for (const auto& file : _files) {
+    _goToLabelStart[file.first] = _goToIndex.size();
+    std::vector<QString> names = getLabelNames(file.first);
+    for (int i = 0; i < (int)names.size(); i++)
+      _goToIndex.add((int)GoToKind::Label, file.first, i, names[i]);
+  }
+  for (VariableRefType type :
+       {VariableRefType::GlobalVar, VariableRefType::Flag}) {
+    GoToKind kind = type == VariableRefType::GlobalVar ? GoToKind::GlobalVar
+                                                       : GoToKind::Flag;
+    _goToVarStart[(int)type] = _goToIndex.size();
+    for (int var = 0; var < variableCount(type); var++)
+      _goToIndex.add((int)kind, -1, var, getVarName(type, var));
+  }
+  // strings never change, so they go last
+  QSqlQuery q(_db);
+  q.setForwardOnly(true);
+  q.exec("SELECT fileId, stringId, text FROM strings");
+  while (q.next()) {
+    _goToIndex.add((int)GoToKind::String, q.value(0).toInt(),
+                   q.value(1).toInt(),
+                   QString::fromUtf8(q.value(2).toByteArray()));
+  }
+  _goToIndexBuilt = true;
 }
 
-std::vector<std::pair<int, SCXOffset>> Project::getLabelRefs(int fileId,
-                                                             int labelId) {
-  _getLabelRefsQuery.addBindValue(fileId);
-  _getLabelRefsQuery.addBindValue(labelId);
-  _getLabelRefsQuery.exec();
+std::vector<FuzzyIndex::Hit> Project::searchAnything(const QString& query,
+                                                     int maxHits) {
+  if (!_goToIndexBuilt) buildGoToIndex();
+  return _goToIndex.search(query, maxHits);
+}
+
+const SC3ControlFlowGraph& Project::controlFlowGraph(int fileId) {
+  auto it = _controlFlowGraphs.find(fileId);
+  if (it == _controlFlowGraphs.end())
+    throw std::runtime_error("No such file: " + std::to_string(fileId));
+  // built along with the disassembly
+  ensureDisassembled(fileId);
+  return it->second;
+}
+
+std::vector<CallGraph::Call> Project::getCallers(int fileId, int labelId) {
+  return _callGraph.callers(fileId, labelId);
+}
+
+std::vector<CallGraph::Call> Project::getCallees(int fileId, int labelId) {
+  return _callGraph.callees(fileId, labelId);
+}
 
-  std::vector<std::pair<int, SCXOffset>> result;
-  while (_getLabelRefsQuery.next()) {
-    result.emplace_back(_getLabelRefsQuery.value(0).toInt(),
-                        _getLabelRefsQuery.value(1).toInt());
+void Project::loadXrefIndexFromDb() {
+  _xrefIndex.clear();
+
+  for (VariableRefType type :
+       {VariableRefType::GlobalVar, VariableRefType::Flag}) {
+    QVariant vtype;
+    vtype.setValue(type);
+    _getAllVariableRefsQuery.addBindValue(vtype);
+    _getAllVariableRefsQuery.exec();
+    while (_getAllVariableRefsQuery.next()) {
+      _xrefIndex.addVariableRef(type,
+                                _getAllVariableRefsQuery.value(0).toInt(),
+                                _getAllVariableRefsQuery.value(1).toInt(),
+                                _getAllVariableRefsQuery.value(2).toInt());
+    }
   }
 
-  return result;
+  _getAllLabelRefsQuery.exec();
+  while (_getAllLabelRefsQuery.next()) {
+    int fileId = _getAllLabelRefsQuery.value(0).toInt();
+    int labelId = _getAllLabelRefsQuery.value(1).toInt();
+    SCXOffset address = _getAllLabelRefsQuery.value(2).toInt();
+    int targetFileId = _getAllLabelRefsQuery.value(3).toInt();
+    _xrefIndex.addFarLabelRef(fileId, address, targetFileId, labelId);
+  }
+
+  _getAllScriptLoadRefsQuery.exec();
+  while (_getAllScriptLoadRefsQuery.next()) {
+    _xrefIndex.addScriptLoadRef(_getAllScriptLoadRefsQuery.value(0).toInt(),
+                                _getAllScriptLoadRefsQuery.value(1).toInt(),
+                                _getAllScriptLoadRefsQuery.value(2).toInt());
+  }
+
+  _getAllStringRefsQuery.exec();
+  while (_getAllStringRefsQuery.next()) {
+    _xrefIndex.addStringRef(_getAllStringRefsQuery.value(0).toInt(),
+                            _getAllStringRefsQuery.value(1).toInt(),
+                            _getAllStringRefsQuery.value(2).toInt());
+  }
+
+  _xrefIndex.build();
+
+  _callGraph.clear();
+  _getAllCallRefsQuery.exec();
+  while (_getAllCallRefsQuery.next()) {
+    _callGraph.addCall(
+        _getAllCallRefsQuery.value(0).toInt(),
+        _getAllCallRefsQuery.value(1).toInt(),
+        _getAllCallRefsQuery.value(2).toInt(),
+        _getAllCallRefsQuery.value(3).toInt(),
+        _getAllCallRefsQuery.value(4).toInt(),
+        (CallGraph::Kind)_getAllCallRefsQuery.value(5).toInt());
+  }
+  _callGraph.build();
+}
+
+void Project::collectFarRefs(const SCXFile* file) {
+  int fileId = file->getId();
+  for (const auto& label : file->disassembly()) {
+    for (const auto& inst : label->instructions()) {
+      int scriptBuffer, targetFileId;
+      std::tie(scriptBuffer, targetFileId) =
+          scriptLoadInInstruction(inst.get());
+      if (targetFileId >= 0) {
+        _scannedScriptLoads.push_back(
+            {fileId, inst->position(), scriptBuffer, targetFileId});
+      }
+      CallGraph::Kind kind;
+      int callKind = CallGraph::kindForInstruction(inst->name(), kind)
+                         ? (int)kind
+                         : -1;
+      for (const auto& ref : farLabelRefsInInstruction(inst.get())) {
+        _scannedFarLabelRefs.push_back(
+            {fileId, inst->position(), ref.first, ref.second, -1, callKind});
+      }
+      if (callKind != CallGraph::LocalCall) continue;
+      for (const auto& arg : inst->args()) {
+        if (arg.type != SC3ArgumentType::LocalLabel || arg.name != "target" ||
+            arg.uint16_value >= file->getLabelCount())
+          continue;
+        _scannedLocalCalls.push_back({fileId, inst->position(), label->id(),
+                                      (int)arg.uint16_value, callKind});
+      }
+    }
+  }
+}
+
+template <typename T>
+static bool refIsBefore(const T& a, const T& b) {
+  return std::tie(a.fileId, a.address) < std::tie(b.fileId, b.address);
+}
+
+void Project::storeScannedRefs(bool farRefs, bool calls) {
+  std::sort(_scannedScriptLoads.begin(), _scannedScriptLoads.end(),
+            refIsBefore<ScriptLoadRef>);
+  std::sort(_scannedFarLabelRefs.begin(), _scannedFarLabelRefs.end(),
+            refIsBefore<FarLabelRef>);
+  resolveFarLabelRefs(_scannedFarLabelRefs, _scannedScriptLoads);
+  // unresolved ones are dropped
+  _scannedFarLabelRefs.erase(
+      std::remove_if(_scannedFarLabelRefs.begin(), _scannedFarLabelRefs.end(),
+                     [this](const FarLabelRef& ref) {
+                       auto target = _files.find(ref.targetFileId);
+                       return target == _files.end() ||
+                              ref.labelId >= target->second->getLabelCount();
+                     }),
+      _scannedFarLabelRefs.end());
+
+  if (farRefs) storeFarRefs();
+  if (calls) storeCallRefs();
+
+  _scannedFarLabelRefs.clear();
+  _scannedScriptLoads.clear();
+  _scannedLocalCalls.clear();
+}
+
+void Project::storeFarRefs() {
+  QVariantList fileIds, addresses, targetFileIds, labelIds;
+  for (const auto& ref : _scannedFarLabelRefs) {
+    fileIds << ref.fileId;
+    addresses << ref.address;
+    targetFileIds << ref.targetFileId;
+    labelIds << ref.labelId;
+    _xrefIndex.addFarLabelRef(ref.fileId, ref.address, ref.targetFileId,
+                              ref.labelId);
+  }
+  if (!fileIds.isEmpty()) {
+    _insertFarLabelRefQuery.addBindValue(fileIds);
+    _insertFarLabelRefQuery.addBindValue(addresses);
+    _insertFarLabelRefQuery.addBindValue(targetFileIds);
+    _insertFarLabelRefQuery.addBindValue(labelIds);
+    _insertFarLabelRefQuery.execBatch();
+  }
+
+  fileIds.clear();
+  addresses.clear();
+  targetFileIds.clear();
+  for (const auto& load : _scannedScriptLoads) {
+    fileIds << load.fileId;
+    addresses << load.address;
+    targetFileIds << load.targetFileId;
+    _xrefIndex.addScriptLoadRef(load.fileId, load.address, load.targetFileId);
+  }
+  if (!fileIds.isEmpty()) {
+    _insertScriptLoadRefQuery.addBindValue(fileIds);
+    _insertScriptLoadRefQuery.addBindValue(addresses);
+    _insertScriptLoadRefQuery.addBindValue(targetFileIds);
+    _insertScriptLoadRefQuery.execBatch();
+  }
+
+  setKey("farRefsScanned", 1);
+}
+
+void Project::storeCallRefs() {
+  QVariantList fileIds, addresses, fromLabelIds, targetFileIds, labelIds,
+      kinds;
+  auto add = [&](int fileId, SCXOffset address, int fromLabelId,
+                 int targetFileId, int labelId, int kind) {
+    fileIds << fileId;
+    addresses << address;
+    fromLabelIds << fromLabelId;
+    targetFileIds << targetFileId;
+    labelIds << labelId;
+    kinds << kind;
+    _callGraph.addCall(fileId, fromLabelId, address, targetFileId, labelId,
+                       (CallGraph::Kind)kind);
+  };
+  for (const auto& call : _scannedLocalCalls) {
+    add(call.fileId, call.address, call.fromLabelId, call.fileId,
+        call.toLabelId, call.callKind);
+  }
+  for (const auto& ref : _scannedFarLabelRefs) {
+    if (ref.callKind < 0) continue;
+    add(ref.fileId, ref.address,
+        labelForAddress(_files.at(ref.fileId).get(), ref.address),
+        ref.targetFileId, ref.labelId, ref.callKind);
+  }
+  if (!fileIds.isEmpty()) {
+    _insertCallRefQuery.addBindValue(fileIds);
+    _insertCallRefQuery.addBindValue(addresses);
+    _insertCallRefQuery.addBindValue(fromLabelIds);
+    _insertCallRefQuery.addBindValue(targetFileIds);
+    _insertCallRefQuery.addBindValue(labelIds);
+    _insertCallRefQuery.addBindValue(kinds);
+    _insertCallRefQuery.execBatch();
+  }
+
+  setKey("callRefsScanned", 1);
+}
+
+void Project::scanMissingRefs() {
+  bool farRefs = !hasKey("farRefsScanned");
+  bool calls = !hasKey("callRefsScanned");
+  bool stringRefs = !hasKey("stringRefsScanned");
+  if (!farRefs && !calls && !stringRefs) return;
+
+  _db.transaction();
+  for (const auto& file : _files) {
+    if (farRefs || calls) collectFarRefs(file.second.get());
+    if (stringRefs) insertStringRefs(file.second.get());
+  }
+  if (farRefs || calls) storeScannedRefs(farRefs, calls);
+  if (stringRefs) setKey("stringRefsScanned", 1);
+  _db.commit();
+  _xrefIndex.build();
+  _callGraph.build();
 }
 
 void Project::insertVariableRef(int fileId, SCXOffset address,
                                 VariableRefType type, int var) {
-  _insertVariableRefQuery.addBindValue(fileId);
-  _insertVariableRefQuery.addBindValue(address);
+  _pendingVarRefFileIds.append(fileId);
+  _pendingVarRefAddresses.append(address);
   QVariant vtype;
   vtype.setValue(type);
-  _insertVariableRefQuery.addBindValue(vtype);
-  _insertVariableRefQuery.addBindValue(var);
-  _insertVariableRefQuery.exec();
+  _pendingVarRefTypes.append(vtype);
+  _pendingVarRefVars.append(var);
+  if (_pendingVarRefFileIds.size() >= RefBatchSize) flushVariableRefs();
 }
 
 void Project::insertLocalLabelRef(int fileId, SCXOffset address, int labelId) {
-  _insertLocalLabelRefQuery.addBindValue(fileId);
-  _insertLocalLabelRefQuery.addBindValue(address);
-  _insertLocalLabelRefQuery.addBindValue(labelId);
-  _insertLocalLabelRefQuery.exec();
+  _pendingLabelRefFileIds.append(fileId);
+  _pendingLabelRefAddresses.append(address);
+  _pendingLabelRefLabelIds.append(labelId);
+  if (_pendingLabelRefFileIds.size() >= RefBatchSize) flushLocalLabelRefs();
+}
+
+void Project::flushVariableRefs() {
+  if (_pendingVarRefFileIds.isEmpty()) return;
+  if (_pendingVarRefFileIds.size() == RefBatchSize) {
+    for (int i = 0; i < RefBatchSize; i++) {
+      _insertVariableRefBatchQuery.addBindValue(_pendingVarRefFileIds[i]);
+      _insertVariableRefBatchQuery.addBindValue(_pendingVarRefAddresses[i]);
+      _insertVariableRefBatchQuery.addBindValue(_pendingVarRefTypes[i]);
+      _insertVariableRefBatchQuery.addBindValue(_pendingVarRefVars[i]);
+    }
+    _insertVariableRefBatchQuery.exec();
+  } else {
+    // leftovers at the end of a file
+    _insertVariableRefQuery.addBindValue(_pendingVarRefFileIds);
+    _insertVariableRefQuery.addBindValue(_pendingVarRefAddresses);
+    _insertVariableRefQuery.addBindValue(_pendingVarRefTypes);
+    _insertVariableRefQuery.addBindValue(_pendingVarRefVars);
+    _insertVariableRefQuery.execBatch();
+  }
+  _pendingVarRefFileIds.clear();
+  _pendingVarRefAddresses.clear();
+  _pendingVarRefTypes.clear();
+  _pendingVarRefVars.clear();
+}
+
+void Project::flushLocalLabelRefs() {
+  if (_pendingLabelRefFileIds.isEmpty()) return;
+  if (_pendingLabelRefFileIds.size() == RefBatchSize) {
+    for (int i = 0; i < RefBatchSize; i++) {
+      _insertLocalLabelRefBatchQuery.addBindValue(_pendingLabelRefFileIds[i]);
+      _insertLocalLabelRefBatchQuery.addBindValue(
+          _pendingLabelRefAddresses[i]);
+      _insertLocalLabelRefBatchQuery.addBindValue(
+          _pendingLabelRefLabelIds[i]);
+    }
+    _insertLocalLabelRefBatchQuery.exec();
+  } else {
+    _insertLocalLabelRefQuery.addBindValue(_pendingLabelRefFileIds);
+    _insertLocalLabelRefQuery.addBindValue(_pendingLabelRefAddresses);
+    _insertLocalLabelRefQuery.addBindValue(_pendingLabelRefLabelIds);
+    _insertLocalLabelRefQuery.execBatch();
+  }
+  _pendingLabelRefFileIds.clear();
+  _pendingLabelRefAddresses.clear();
+  _pendingLabelRefLabelIds.clear();
 }
 
 void Project::insertString(int fileId, int stringId,
@@ -474,36 +955,98 @@ void Project::setGameId(int gameId) {
   _setGameIdQuery.exec();
 }
 
+bool Project::hasKey(const QString& key) {
+  QSqlQuery q(_db);
+  q.prepare("SELECT value FROM keyValue WHERE key = ?");
+  q.addBindValue(key);
+  q.exec();
+  return q.next();
+}
+
+void Project::setKey(const QString& key, const QVariant& value) {
+  QSqlQuery q(_db);
+  q.prepare("REPLACE INTO keyValue (key, value) VALUES (?, ?)");
+  q.addBindValue(key);
+  q.addBindValue(value);
+  q.exec();
+}
+
+void Project::persistVariable(VariableRefType type, int var) {
+  const auto& names = _varNames[(int)type];
+  const auto& comments = _varComments[(int)type];
+  _writer->setVariable(
+      type, var, var < (int)names.size() ? names[var] : QString(),
+      var < (int)comments.size() ? comments[var] : QString());
+}
+
 int Project::getVariableId(VariableRefType type, const QString& name) {
-  QVariant vtype;
-  vtype.setValue(type);
-  _getVarByNameQuery.addBindValue(vtype);
-  _getVarByNameQuery.addBindValue(name.toUtf8());
-  _getVarByNameQuery.exec();
-  _getVarByNameQuery.next();
+  int id = _varIdsByName[(int)type].value(name, -1);
+  if (id >= 0) return id;
+
+  // unnamed variables are called by their number
+  bool ok;
+  id = name.toInt(&ok);
+  if (!ok || id < 0 || id >= variableCount(type) ||
+      name != QString::number(id))
+    return -1;
+  const auto& names = _varNames[(int)type];
+  if (id < (int)names.size() && !names[id].isEmpty()) return -1;
+  return id;
+}
 
-  int result = -1;
-  if (_getVarByNameQuery.isValid()) {
-    result = _getVarByNameQuery.value(0).toInt();
+void Project::loadNamesFromDb() {
+  for (VariableRefType type :
+       {VariableRefType::GlobalVar, VariableRefType::Flag}) {
+    _varNames[(int)type].clear();
+    _varIdsByName[(int)type].clear();
+    _varComments[(int)type].clear();
+    QVariant vtype;
+    vtype.setValue(type);
+    _getAllVarNamesQuery.addBindValue(vtype);
+    _getAllVarNamesQuery.exec();
+    while (_getAllVarNamesQuery.next()) {
+      int var = _getAllVarNamesQuery.value(0).toInt();
+      cacheVarName(
+          type, var,
+          QString::fromUtf8(_getAllVarNamesQuery.value(1).toByteArray()));
+      QString comment =
+          QString::fromUtf8(_getAllVarNamesQuery.value(2).toByteArray());
+      if (!comment.isEmpty()) {
+        auto& comments = _varComments[(int)type];
+        if (var >= (int)comments.size()) comments.resize(var + 1);
+        comments[var] = comment;
+      }
+    }
+  }
+
+  _labelNames.clear();
+  _getAllLabelNamesQuery.exec();
+  while (_getAllLabelNamesQuery.next()) {
+    QString name =
+        QString::fromUtf8(_getAllLabelNamesQuery.value(2).toByteArray());
+    if (name.isEmpty()) continue;
+    _labelNames[_getAllLabelNamesQuery.value(0).toInt()]
+               [_getAllLabelNamesQuery.value(1).toInt()] = name;
   }
-  return result;
 }
+
 std::pair<VariableRefType, int> Project::parseVarRefString(const QString& str) {
-  QRegExp regex("^(GlobalVars|Flags)\\[(.+)\\]$");
+  static const QRegularExpression regex("^(GlobalVars|Flags)\\[(.+)\\]$");
 
   std::pair<VariableRefType, int> invalidResult =
       std::make_pair((VariableRefType)-1, -1);
 
-  if (regex.indexIn(str) < 0) return invalidResult;
-  VariableRefType type = regex.cap(1) == "GlobalVars"
+  QRegularExpressionMatch match = regex.match(str);
+  if (!match.hasMatch()) return invalidResult;
+  VariableRefType type = match.captured(1) == "GlobalVars"
                              ? VariableRefType::GlobalVar
                              : VariableRefType::Flag;
-  QString name = regex.cap(2);
+  QString name = match.captured(2);
   int id = getVariableId(type, name);
   if (id < 0) {
     bool ok;
     id = name.toInt(&ok);
-    if (!ok || id >= 8000) return invalidResult;
+    if (!ok || id < 0 || id >= variableCount(type)) return invalidResult;
   }
   return std::make_pair(type, id);
 }
@@ -518,7 +1061,6 @@ void Project::importWorklist(const QString& path, const char* encoding) {
 
   VariableRefType currentType = VariableRefType::GlobalVar;
 
-  _db.transaction();
   _batchUpdatingVars = true;
   QString name;
   int var;
@@ -553,7 +1095,6 @@ void Project::importWorklist(const QString& path, const char* encoding) {
       in.seek(pos);
     }
   }
-  _db.commit();
   _batchUpdatingVars = false;
   emit allVarsChanged();
 }
@@ -562,6 +1103,10 @@ void Project::openDatabase(const QString& path) {
   _db = QSqlDatabase::addDatabase("QSQLITE");
   _db.setDatabaseName(path);
   _db.open();
+
+  // shared by all projects in the same directory
+  _scriptStore.reset(
+      new ScriptStore(QFileInfo(path).absolutePath() + "/scripts"));
 }
 
 void Project::createDatabase(const QString& path) {
@@ -574,7 +1119,7 @@ void Project::createDatabase(const QString& path) {
       "CREATE TABLE files("
       "id INTEGER PRIMARY KEY,"
       "name VARCHAR NOT NULL,"
-      "data BLOB NOT NULL"
+      "hash TEXT NOT NULL"
       ")");
   q.exec(
       "CREATE TABLE comments("
@@ -614,6 +1159,7 @@ void Project::createDatabase(const QString& path) {
       "address INTEGER NOT NULL,"
       "labelId INTEGER NOT NULL"
       ")");
+  createRefTables();
   q.exec(
       "CREATE TABLE strings("
       "fileId INTEGER NOT NULL,"
@@ -629,58 +1175,138 @@ void Project::createDatabase(const QString& path) {
   prepareStmts();
 }
 
+// Tables added after the original schema, also created for older projects.
+// Only far refs that could be resolved to a script are stored.
+void Project::createRefTables() {
+  QSqlQuery q(_db);
+  q.exec(
+      "CREATE TABLE IF NOT EXISTS farLabelRefs("
+      "refId INTEGER PRIMARY KEY,"
+      "fileId INTEGER NOT NULL,"
+      "address INTEGER NOT NULL,"
+      "targetFileId INTEGER NOT NULL,"
+      "labelId INTEGER NOT NULL"
+      ")");
+  q.exec(
+      "CREATE TABLE IF NOT EXISTS scriptLoadRefs("
+      "refId INTEGER PRIMARY KEY,"
+      "fileId INTEGER NOT NULL,"
+      "address INTEGER NOT NULL,"
+      "targetFileId INTEGER NOT NULL"
+      ")");
+  q.exec(
+      "CREATE TABLE IF NOT EXISTS stringRefs("
+      "refId INTEGER PRIMARY KEY,"
+      "fileId INTEGER NOT NULL,"
+      "address INTEGER NOT NULL,"
+      "stringId INTEGER NOT NULL"
+      ")");
+  // CallGraph edges, kind is a CallGraph::Kind
+  q.exec(
+      "CREATE TABLE IF NOT EXISTS callRefs("
+      "refId INTEGER PRIMARY KEY,"
+      "fileId INTEGER NOT NULL,"
+      "address INTEGER NOT NULL,"
+      "fromLabelId INTEGER NOT NULL,"
+      "targetFileId INTEGER NOT NULL,"
+      "labelId INTEGER NOT NULL,"
+      "kind INTEGER NOT NULL"
+      ")");
+}
+
+void Project::pruneDefaultVariables() {
+  QSqlQuery q(_db);
+  q.exec(
+      "DELETE FROM variables WHERE CAST(name AS TEXT) = CAST(variable AS "
+      "TEXT) AND (comment IS NULL OR CAST(comment AS TEXT) = '')");
+}
+
+// Created after the initial import, so the bulk inserts don't have to keep
+// them up to date
+void Project::createIndexes() {
+  QSqlQuery q(_db);
+  q.exec(
+      "CREATE INDEX IF NOT EXISTS variableRefsByVariable ON "
+      "variableRefs (variableType, variable)");
+  q.exec(
+      "CREATE INDEX IF NOT EXISTS localLabelRefsByLabel ON "
+      "localLabelRefs (fileId, labelId)");
+}
+
 // Unfortunately these tables need to exist before we can prepare the statements
 void Project::prepareStmts() {
-  _getCommentQuery = QSqlQuery(_db);
-  _getCommentQuery.prepare(
-      "SELECT text FROM comments WHERE fileId = ? AND address = ?");
-  _setCommentQuery = QSqlQuery(_db);
-  _setCommentQuery.prepare(
-      "REPLACE INTO comments (fileId, address, text) VALUES (?, ?, ?)");
-  _getLabelNameQuery = QSqlQuery(_db);
-  _getLabelNameQuery.prepare(
-      "SELECT name FROM labels WHERE fileId = ? AND labelId = ?");
-  _setLabelNameQuery = QSqlQuery(_db);
-  _setLabelNameQuery.prepare(
-      "REPLACE INTO labels (fileId, labelId, name) VALUES (?, ?, ?)");
+  _getAllCommentsQuery = QSqlQuery(_db);
+  _getAllCommentsQuery.setForwardOnly(true);
+  _getAllCommentsQuery.prepare("SELECT fileId, address, text FROM comments");
+  _getAllLabelNamesQuery = QSqlQuery(_db);
+  _getAllLabelNamesQuery.setForwardOnly(true);
+  _getAllLabelNamesQuery.prepare("SELECT fileId, labelId, name FROM labels");
   _getFilesQuery = QSqlQuery(_db);
-  _getFilesQuery.prepare("SELECT id, name, data FROM files ORDER BY id ASC");
+  _getFilesQuery.prepare("SELECT id, name, hash FROM files ORDER BY id ASC");
   _insertFileQuery = QSqlQuery(_db);
   _insertFileQuery.prepare(
-      "INSERT INTO files (id, name, data) VALUES (?, ?, ?)");
+      "INSERT INTO files (id, name, hash) VALUES (?, ?, ?)");
   _getAllVarNamesQuery = QSqlQuery(_db);
+  _getAllVarNamesQuery.setForwardOnly(true);
   _getAllVarNamesQuery.prepare(
-      "SELECT name FROM variables WHERE variableType = ? ORDER BY variable "
-      "ASC");
-  _getVarNameQuery = QSqlQuery(_db);
-  _getVarNameQuery.prepare(
-      "SELECT name FROM variables WHERE variableType = ? AND variable = ?");
-  _getVarCommentQuery = QSqlQuery(_db);
-  _getVarCommentQuery.prepare(
-      "SELECT comment FROM variables WHERE variableType = ? AND variable = ?");
-  _insertVariableQuery = QSqlQuery(_db);
-  _insertVariableQuery.prepare(
-      "INSERT INTO variables (variableType, variable, name) VALUES (?, ?, ?)");
-  _setVarNameQuery = QSqlQuery(_db);
-  _setVarNameQuery.prepare(
-      "UPDATE variables SET name = ? WHERE variableType = ? AND variable = ?");
-  _setVarCommentQuery = QSqlQuery(_db);
-  _setVarCommentQuery.prepare(
-      "UPDATE variables SET comment = ? WHERE variableType = ? AND variable = "
-      "?");
-  _getVariableRefsQuery = QSqlQuery(_db);
-  _getVariableRefsQuery.prepare(
-      "SELECT fileId, address FROM variableRefs WHERE variableType = ? AND "
-      "variable = ?");
+      "SELECT variable, name, comment FROM variables WHERE variableType = ?");
+  _getAllVariableRefsQuery = QSqlQuery(_db);
+  _getAllVariableRefsQuery.setForwardOnly(true);
+  _getAllVariableRefsQuery.prepare(
+      "SELECT variable, fileId, address FROM variableRefs WHERE variableType "
+      "= ?");
   _insertVariableRefQuery = QSqlQuery(_db);
   _insertVariableRefQuery.prepare(
       "INSERT INTO variableRefs (fileId, address, variableType, variable) "
       "VALUES (?, ?, ?, ?)");
-  // TODO union with far label refs
-  _getLabelRefsQuery = QSqlQuery(_db);
-  _getLabelRefsQuery.prepare(
-      "SELECT fileId, address FROM localLabelRefs WHERE fileId = ? AND labelId "
-      "= ?");
+  // multi-row VALUES, RefBatchSize rows at a time
+  QStringList varRefRows, labelRefRows;
+  for (int i = 0; i < RefBatchSize; i++) {
+    varRefRows << "(?, ?, ?, ?)";
+    labelRefRows << "(?, ?, ?)";
+  }
+  _insertVariableRefBatchQuery = QSqlQuery(_db);
+  _insertVariableRefBatchQuery.prepare(
+      "INSERT INTO variableRefs (fileId, address, variableType, variable) "
+      "VALUES " +
+      varRefRows.join(", "));
+  _insertLocalLabelRefBatchQuery = QSqlQuery(_db);
+  _insertLocalLabelRefBatchQuery.prepare(
+      "INSERT INTO localLabelRefs (fileId, address, labelId) VALUES " +
+      labelRefRows.join(", "));
+  _getAllLabelRefsQuery = QSqlQuery(_db);
+  _getAllLabelRefsQuery.setForwardOnly(true);
+  _getAllLabelRefsQuery.prepare(
+      "SELECT fileId, labelId, address, fileId FROM localLabelRefs UNION ALL "
+      "SELECT fileId, labelId, address, targetFileId FROM farLabelRefs");
+  _insertFarLabelRefQuery = QSqlQuery(_db);
+  _insertFarLabelRefQuery.prepare(
+      "INSERT INTO farLabelRefs (fileId, address, targetFileId, labelId) "
+      "VALUES (?, ?, ?, ?)");
+  _getAllCallRefsQuery = QSqlQuery(_db);
+  _getAllCallRefsQuery.setForwardOnly(true);
+  _getAllCallRefsQuery.prepare(
+      "SELECT fileId, fromLabelId, address, targetFileId, labelId, kind FROM "
+      "callRefs");
+  _insertCallRefQuery = QSqlQuery(_db);
+  _insertCallRefQuery.prepare(
+      "INSERT INTO callRefs (fileId, address, fromLabelId, targetFileId, "
+      "labelId, kind) VALUES (?, ?, ?, ?, ?, ?)");
+  _getAllScriptLoadRefsQuery = QSqlQuery(_db);
+  _getAllScriptLoadRefsQuery.setForwardOnly(true);
+  _getAllScriptLoadRefsQuery.prepare(
+      "SELECT fileId, address, targetFileId FROM scriptLoadRefs");
+  _getAllStringRefsQuery = QSqlQuery(_db);
+  _getAllStringRefsQuery.setForwardOnly(true);
+  _getAllStringRefsQuery.prepare(
+      "SELECT fileId, stringId, address FROM stringRefs");
+  _insertStringRefQuery = QSqlQuery(_db);
+  _insertStringRefQuery.prepare(
+      "INSERT INTO stringRefs (fileId, address, stringId) VALUES (?, ?, ?)");
+  _insertScriptLoadRefQuery = QSqlQuery(_db);
+  _insertScriptLoadRefQuery.prepare(
+      "INSERT INTO scriptLoadRefs (fileId, address, targetFileId) VALUES (?, "
+      "?, ?)");
   _insertLocalLabelRefQuery = QSqlQuery(_db);
   _insertLocalLabelRefQuery.prepare(
       "INSERT INTO localLabelRefs (fileId, address, labelId) VALUES (?, ?, ?)");
@@ -696,7 +1322,4 @@ void Project::prepareStmts() {
   _setGameIdQuery = QSqlQuery(_db);
   _setGameIdQuery.prepare(
       "REPLACE INTO keyValue (key, value) VALUES ('gameId', ?)");
-  _getVarByNameQuery = QSqlQuery(_db);
-  _getVarByNameQuery.prepare(
-      "SELECT variable FROM variables WHERE variableType = ? AND name = ?");
 }
@@ -2,12 +2,25 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <QObject>
+#include "parser/MPKArchive.h"
+#include "parser/SC3ControlFlow.h"
+#include "parser/SC3InstructionSearch.h"
 #include "parser/SCXFile.h"
 #include "parser/SupportedGame.h"
 #include <QtSql>
 #include "enums.h"
 #include "projectcontextprovider.h"
+#include "analysis.h"
+#include "callgraph.h"
+#include "fuzzyindex.h"
+#include "stringindex.h"
+#include "xrefindex.h"
+
+class BackgroundDisassembler;
+class ProjectWriter;
+class ScriptStore;
 
 class Project : public QObject {
   Q_OBJECT
@@ -24,16 +37,28 @@ class Project : public QObject {
   int currentFileId() const { return _currentFileId; }
   const SCXFile* currentFile() const;
 
+  // Opened projects disassemble their files in the background. Only the
+  // current file is guaranteed to be disassembled; wait for any other file
+  // before touching its disassembly().
+  bool isDisassembled(int fileId) const;
+  void ensureDisassembled(int fileId);
+  void waitForDisassembly();
+
   IContextProvider* contextProvider() { return &_contextProvider; }
+  const SupportedGame* game() const { return _game; }
 
   void switchFile(int id);
   void goToAddress(int fileId, SCXOffset address);
   void focusMemory(VariableRefType type, int var);
 
   QString getComment(int fileId, SCXOffset address);
+  // all non-empty comments in a file, ordered by address
+  const std::map<SCXOffset, QString>& getComments(int fileId);
   void setComment(int fileId, SCXOffset address, const QString& comment);
 
   QString getLabelName(int fileId, int labelId);
+  // every label of the file in id order, in one pass over the name cache
+  std::vector<QString> getLabelNames(int fileId);
   void setLabelName(int fileId, int labelId, const QString& name);
 
   QString getVarName(VariableRefType type, int var);
@@ -44,13 +69,38 @@ class Project : public QObject {
 
   QString getString(int fileId, int stringId);
   int getStringCount(int fileId);
+  // case-insensitive, maxHits < 0 means no limit
+  std::vector<StringIndex::Hit> searchStrings(const QString& query,
+                                              int maxHits = -1);
+  // instructions using the string
+  std::vector<std::pair<int, SCXOffset>> getStringRefs(int fileId,
+                                                       int stringId);
 
   std::vector<QString> getVariableNames(VariableRefType type, int var);
   std::vector<std::pair<int, SCXOffset>> getVariableRefs(VariableRefType type,
                                                          int var);
+  // local refs and far refs from other scripts
   std::vector<std::pair<int, SCXOffset>> getLabelRefs(int fileId, int labelId);
+  // ScriptLoads of the script
+  std::vector<std::pair<int, SCXOffset>> getScriptLoadRefs(int fileId);
+  // Labels calling / called from a label. The first query waits for all
+  // files to be disassembled
+  std::vector<CallGraph::Call> getCallers(int fileId, int labelId);
+  std::vector<CallGraph::Call> getCallees(int fileId, int labelId);
+  // see SC3InstructionQuery for the syntax. The first search waits for all
+  // files to be disassembled. throws std::runtime_error on syntax errors
+  std::vector<SC3SearchHit> searchInstructions(const QString& query);
+  // Basic blocks of a script, built as soon as it's disassembled. Waits for
+  // that like ensureDisassembled. throws std::runtime_error for unknown files
+  const SC3ControlFlowGraph& controlFlowGraph(int fileId);
+  // Fuzzy match over file, label and variable names and strings, entry kinds
+  // are GoToKind. The index is built on first use and follows renames.
+  std::vector<FuzzyIndex::Hit> searchAnything(const QString& query,
+                                              int maxHits);
+  const FuzzyIndex& goToIndex() const { return _goToIndex; }
 
   int getVariableId(VariableRefType type, const QString& name);
+  int variableCount(VariableRefType type) const;
   std::pair<VariableRefType, int> parseVarRefString(const QString& str);
 
   void importWorklist(const QString& path, const char* encoding);
@@ -64,11 +114,14 @@ class Project : public QObject {
   void varNameChanged(VariableRefType type, int var, const QString& name);
   void varCommentChanged(VariableRefType type, int var, const QString& comment);
   void allVarsChanged();
+  void fileDisassembled(int fileId);
+  void disassemblyProgress(int done, int total);
 
  private:
   const SupportedGame* _game;
 
   QSqlDatabase _db;
+  std::unique_ptr<ScriptStore> _scriptStore;
   std::map<int, std::unique_ptr<SCXFile>> _files;
   int _currentFileId = -1;
   bool _inInitialLoad = true;
@@ -77,13 +130,47 @@ class Project : public QObject {
 
   ProjectContextProvider _contextProvider;
 
+  XrefIndex _xrefIndex;
+  CallGraph _callGraph;
+  StringIndex _stringIndex;
+  // built on first use
+  std::unique_ptr<SC3InstructionSearch> _instructionSearch;
+  // by fileId, every file has an entry from the start
+  std::map<int, SC3ControlFlowGraph> _controlFlowGraphs;
+  FuzzyIndex _goToIndex;
+  bool _goToIndexBuilt = false;
+  // first entry of each file's labels, and of each variable type
+  std::map<int, int> _goToLabelStart;
+  int _goToVarStart[2];
+  void buildGoToIndex();
+  // far refs can only be resolved once every script has been seen
+  std::vector<FarLabelRef> _scannedFarLabelRefs;
+  std::vector<ScriptLoadRef> _scannedScriptLoads;
+  std::vector<LocalCallRef> _scannedLocalCalls;
+
+  // Names are read from the DB once and written through on change, since
+  // they're looked up for every rendered row. Empty means default name.
+  std::vector<QString> _varNames[2];
+  QHash<QString, int> _varIdsByName[2];
+  std::map<int, std::unordered_map<int, QString>> _labelNames;
+  void cacheVarName(VariableRefType type, int var, const QString& name);
+  void persistVariable(VariableRefType type, int var);
+  std::vector<QString> _varComments[2];
+  std::map<int, std::map<SCXOffset, QString>> _comments;
+
+  // all edits after the initial load go through this
+  std::unique_ptr<ProjectWriter> _writer;
+  std::unique_ptr<BackgroundDisassembler> _disassembler;
+
   struct TmpFileData {
     int id;
     QString name;
     uint8_t* data;
     int size;
+    size_t archiveIndex;
   };
-  bool importMpk(const QString& mpkPath, std::vector<TmpFileData>& dest);
+  bool importMpk(const QString& mpkPath, std::vector<TmpFileData>& dest,
+                 std::unique_ptr<MPKArchive>& archive);
   bool importMlp(const QString& mlpPath, std::vector<TmpFileData>& dest);
 
   void createDatabase(const QString& path);
@@ -91,35 +178,65 @@ class Project : public QObject {
   void prepareStmts();
   void analyzeFile(const SCXFile* file);
   void loadFilesFromDb();
+  void migrateFilesToScriptStore();
+  void loadXrefIndexFromDb();
+  void loadNamesFromDb();
+  void loadCommentsFromDb();
+  void createIndexes();
+  void createRefTables();
+  // also collects the calls, which go into the call graph
+  void collectFarRefs(const SCXFile* file);
+  // resolves what collectFarRefs found and stores the far refs and/or calls
+  void storeScannedRefs(bool farRefs, bool calls);
+  void storeFarRefs();
+  void storeCallRefs();
+  void insertStringRefs(const SCXFile* file);
+  void loadStringsFromDb();
+  void scanMissingRefs();
+  void pruneDefaultVariables();
   void insertFile(const QString& name, uint8_t* data, int size, int id);
-  void insertVariable(VariableRefType type, int var, const QString& name);
   void insertVariableRef(int fileId, SCXOffset address, VariableRefType type,
                          int var);
   void insertLocalLabelRef(int fileId, SCXOffset address, int labelId);
+  void flushVariableRefs();
+  void flushLocalLabelRefs();
   void insertString(int fileId, int stringId, const std::string& string);
 
   int getGameId();
   void setGameId(int gameId);
+  bool hasKey(const QString& key);
+  void setKey(const QString& key, const QVariant& value);
 
-  QSqlQuery _getCommentQuery;
-  QSqlQuery _setCommentQuery;
-  QSqlQuery _getLabelNameQuery;
-  QSqlQuery _setLabelNameQuery;
+  QSqlQuery _getAllCommentsQuery;
+  QSqlQuery _getAllLabelNamesQuery;
   QSqlQuery _getFilesQuery;
   QSqlQuery _insertFileQuery;
   QSqlQuery _getAllVarNamesQuery;
-  QSqlQuery _getVarNameQuery;
-  QSqlQuery _getVarCommentQuery;
-  QSqlQuery _insertVariableQuery;
-  QSqlQuery _setVarNameQuery;
-  QSqlQuery _setVarCommentQuery;
-  QSqlQuery _getVariableRefsQuery;
+  QSqlQuery _getAllVariableRefsQuery;
   QSqlQuery _insertVariableRefQuery;
-  QSqlQuery _getLabelRefsQuery;
+  QSqlQuery _getAllLabelRefsQuery;
   QSqlQuery _insertLocalLabelRefQuery;
+  QSqlQuery _insertFarLabelRefQuery;
+  QSqlQuery _getAllCallRefsQuery;
+  QSqlQuery _insertCallRefQuery;
+  QSqlQuery _getAllScriptLoadRefsQuery;
+  QSqlQuery _insertScriptLoadRefQuery;
+  QSqlQuery _getAllStringRefsQuery;
+  QSqlQuery _insertStringRefQuery;
   QSqlQuery _getStringQuery;
   QSqlQuery _insertStringQuery;
   QSqlQuery _getGameIdQuery;
   QSqlQuery _setGameIdQuery;
-  QSqlQuery _getVarByNameQuery;
+
+  // xrefs are collected columnwise and written RefBatchSize rows per INSERT
+  static const int RefBatchSize = 200;
+  QSqlQuery _insertVariableRefBatchQuery;
+  QSqlQuery _insertLocalLabelRefBatchQuery;
+  QVariantList _pendingVarRefFileIds;
+  QVariantList _pendingVarRefAddresses;
+  QVariantList _pendingVarRefTypes;
+  QVariantList _pendingVarRefVars;
+  QVariantList _pendingLabelRefFileIds;
+  QVariantList _pendingLabelRefAddresses;
+  QVariantList _pendingLabelRefLabelIds;
 };
\ No newline at end of file
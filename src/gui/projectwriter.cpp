@@ -0,0 +1,176 @@
+#include "projectwriter.h"
+#include <chrono>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+
+ProjectWriter::ProjectWriter(const QString& dbPath)
+    : _dbPath(dbPath),
+      _connectionName(
+          QString("ProjectWriter_%1").arg((quintptr)this, 0, 16)) {
+  _thread = std::thread(&ProjectWriter::run, this);
+}
+
+ProjectWriter::~ProjectWriter() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _queueCond.notify_all();
+  _thread.join();
+}
+
+void ProjectWriter::setComment(int fileId, SCXOffset address,
+                               const QString& comment) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending.comments[std::make_pair(fileId, address)] = comment;
+  }
+  _queueCond.notify_all();
+}
+
+void ProjectWriter::setLabelName(int fileId, int labelId,
+                                 const QString& name) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending.labelNames[std::make_pair(fileId, labelId)] = name;
+  }
+  _queueCond.notify_all();
+}
+
+void ProjectWriter::setVariable(VariableRefType type, int var,
+                                const QString& name, const QString& comment) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending.variables[std::make_pair(type, var)] =
+        std::make_pair(name, comment);
+  }
+  _queueCond.notify_all();
+}
+
+void ProjectWriter::run() {
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", _connectionName);
+    db.setDatabaseName(_dbPath);
+    db.open();
+    QSqlQuery pragma(db);
+    pragma.exec("PRAGMA journal_mode = WAL");
+    pragma.exec("PRAGMA synchronous = NORMAL");
+  }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _queueCond.wait(lock, [&]() { return _stopping || !_pending.empty(); });
+    // give edits that come in quick succession (e.g. worklist imports) a
+    // chance to end up in the same transaction
+    if (!_stopping) {
+      _queueCond.wait_for(lock, std::chrono::milliseconds(BatchDelayMs),
+                          [&]() { return _stopping; });
+    }
+
+    Batch batch;
+    std::swap(batch, _pending);
+
+    lock.unlock();
+    if (!batch.empty()) writeBatch(batch);
+    lock.lock();
+
+    if (_stopping && _pending.empty()) break;
+  }
+  lock.unlock();
+
+  {
+    // Project switches back out of WAL once this connection is gone
+    QSqlDatabase db = QSqlDatabase::database(_connectionName, false);
+    db.close();
+  }
+  QSqlDatabase::removeDatabase(_connectionName);
+}
+
+void ProjectWriter::writeBatch(const Batch& batch) {
+  QSqlDatabase db = QSqlDatabase::database(_connectionName, false);
+  db.transaction();
+
+  if (!batch.comments.empty()) {
+    QSqlQuery q(db);
+    q.prepare("REPLACE INTO comments (fileId, address, text) VALUES (?, ?, ?)");
+    for (const auto& comment : batch.comments) {
+      q.addBindValue(comment.first.first);
+      q.addBindValue(comment.first.second);
+      q.addBindValue(comment.second.toUtf8());
+      q.exec();
+    }
+  }
+
+  if (!batch.labelNames.empty()) {
+    QSqlQuery q(db);
+    q.prepare("REPLACE INTO labels (fileId, labelId, name) VALUES (?, ?, ?)");
+    for (const auto& name : batch.labelNames) {
+      q.addBindValue(name.first.first);
+      q.addBindValue(name.first.second);
+      q.addBindValue(name.second.toUtf8());
+      q.exec();
+    }
+  }
+
+  if (!batch.variables.empty()) {
+    // Coalescing loses the order of renames, and names are UNIQUE per type,
+    // so move everything out of the way first. The final state is unique.
+    QSqlQuery rename(db);
+    rename.prepare(
+        "UPDATE variables SET name = ? WHERE variableType = ? AND variable = "
+        "?");
+    for (const auto& variable : batch.variables) {
+      QVariant vtype;
+      vtype.setValue(variable.first.first);
+      rename.addBindValue(
+          QString("\x01renaming_%1").arg(variable.first.second).toUtf8());
+      rename.addBindValue(vtype);
+      rename.addBindValue(variable.first.second);
+      rename.exec();
+    }
+
+    // REPLACE would silently delete another variable holding the name,
+    // comment and all
+    QSqlQuery upsert(db);
+    upsert.prepare(
+        "INSERT INTO variables (variableType, variable, name, comment) "
+        "VALUES (?, ?, ?, ?) ON CONFLICT (variableType, variable) DO UPDATE "
+        "SET name = excluded.name, comment = excluded.comment");
+    QSqlQuery remove(db);
+    remove.prepare(
+        "DELETE FROM variables WHERE variableType = ? AND variable = ?");
+    for (const auto& variable : batch.variables) {
+      QVariant vtype;
+      vtype.setValue(variable.first.first);
+      int var = variable.first.second;
+      const QString& name = variable.second.first;
+      const QString& comment = variable.second.second;
+      if (name.isEmpty() && comment.isEmpty()) {
+        remove.addBindValue(vtype);
+        remove.addBindValue(var);
+        remove.exec();
+        continue;
+      }
+      upsert.addBindValue(vtype);
+      upsert.addBindValue(var);
+      upsert.addBindValue(
+          (name.isEmpty() ? QString::number(var) : name).toUtf8());
+      upsert.addBindValue(comment.toUtf8());
+      if (upsert.exec()) continue;
+
+      // the name is taken. Keep the comment under the default name rather
+      // than leaving the placeholder from above
+      qWarning("Couldn't name variable %d %s: %s", var, qPrintable(name),
+               qPrintable(upsert.lastError().text()));
+      upsert.addBindValue(vtype);
+      upsert.addBindValue(var);
+      upsert.addBindValue(QString::number(var).toUtf8());
+      upsert.addBindValue(comment.toUtf8());
+      upsert.exec();
+    }
+  }
+
+  db.commit();
+}
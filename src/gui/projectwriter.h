@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <QString>
+#include <parser/SCXTypes.h>
+#include "enums.h"
+
+// Write-behind persistence for user edits. Project updates its in-memory state
+// immediately and queues the write here; a background thread with its own
+// connection coalesces queued writes per key and commits them in batches, one
+// transaction each, so the file always holds a consistent prefix of the edits.
+class ProjectWriter {
+ public:
+  explicit ProjectWriter(const QString& dbPath);
+  // flushes everything still queued
+  ~ProjectWriter();
+
+  void setComment(int fileId, SCXOffset address, const QString& comment);
+  void setLabelName(int fileId, int labelId, const QString& name);
+  // empty name and comment means the variable is back to its defaults, and
+  // its row gets deleted
+  void setVariable(VariableRefType type, int var, const QString& name,
+                   const QString& comment);
+
+ private:
+  struct Batch {
+    std::map<std::pair<int, SCXOffset>, QString> comments;
+    std::map<std::pair<int, int>, QString> labelNames;
+    // (name, comment)
+    std::map<std::pair<VariableRefType, int>, std::pair<QString, QString>>
+        variables;
+
+    bool empty() const {
+      return comments.empty() && labelNames.empty() && variables.empty();
+    }
+  };
+
+  // how long the thread waits for more edits before committing
+  static const int BatchDelayMs = 250;
+
+  const QString _dbPath;
+  const QString _connectionName;
+
+  std::mutex _mutex;
+  std::condition_variable _queueCond;
+  Batch _pending;
+  bool _stopping = false;
+  std::thread _thread;
+
+  void enqueued();
+  void run();
+  void writeBatch(const Batch& batch);
+};
@@ -0,0 +1,153 @@
+#include "scriptdiffdialog.h"
+#include "debuggerapplication.h"
+#include "project.h"
+#include "textdump.h"
+#include <QDialogButtonBox>
+#include <QFile>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QVBoxLayout>
+#include <parser/SC3BaseDisassembler.h>
+#include <parser/SC3ScriptDiff.h>
+#include <parser/SupportedGame.h>
+#include <cstring>
+#include <stdexcept>
+
+static const QColor RemovedColor(255, 220, 220);
+static const QColor AddedColor(220, 255, 220);
+static const QColor LabelColor(230, 230, 230);
+
+ScriptDiffDialog::ScriptDiffDialog(int fileId, const QString &otherPath,
+                                   QWidget *parent)
+    : QDialog(parent), _fileId(fileId) {
+  QFile file(otherPath);
+  if (!file.open(QFile::ReadOnly))
+    throw std::runtime_error("Couldn't read script");
+  QByteArray data = file.readAll();
+  uint8_t *buf = (uint8_t *)malloc(data.size());
+  memcpy(buf, data.constData(), data.size());
+  _otherFile.reset(new SCXFile(buf, (SCXOffset)data.size(),
+                               QFileInfo(otherPath).fileName().toStdString(),
+                               -1));
+
+  Project *project = dApp->project();
+  SC3BaseDisassembler *dis = project->game()->createDisassembler(*_otherFile);
+  dis->DisassembleFile();
+  delete dis;
+  project->ensureDisassembled(fileId);
+  const SCXFile *projectFile = project->files().at(fileId).get();
+
+  setWindowTitle(QString("Compare %1 with %2")
+                     .arg(QString::fromStdString(projectFile->getName()))
+                     .arg(QString::fromStdString(_otherFile->getName())));
+
+  _statusLabel = new QLabel(this);
+
+  _table = new QTableWidget(this);
+  _table->setColumnCount(2);
+  _table->setHorizontalHeaderLabels(
+      QStringList() << QString::fromStdString(projectFile->getName())
+                    << QString::fromStdString(_otherFile->getName()));
+  QHeaderView *header = _table->horizontalHeader();
+  header->setSectionsMovable(false);
+  header->setSectionResizeMode(QHeaderView::Stretch);
+  _table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  _table->setSelectionBehavior(QAbstractItemView::SelectRows);
+  _table->setSelectionMode(QAbstractItemView::SingleSelection);
+  _table->verticalHeader()->setVisible(false);
+  connect(_table, &QTableWidget::cellDoubleClicked, this,
+          &ScriptDiffDialog::goToRow);
+
+  QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+  connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addWidget(_statusLabel);
+  layout->addWidget(_table);
+  layout->addWidget(buttons);
+  setLayout(layout);
+
+  SC3ScriptDiff diff = DiffSCXFiles(projectFile, _otherFile.get());
+  IContextProvider *ctx = project->contextProvider();
+  // the other file has no names of its own
+  SC3TextRenderer leftRenderer(false, ctx, fileId);
+  SC3TextRenderer rightRenderer(false, nullptr, -1);
+  auto leftText = [&](const SC3Instruction *inst) {
+    return QString::fromStdString(leftRenderer.instructionText(inst));
+  };
+  auto rightText = [&](const SC3Instruction *inst) {
+    return QString::fromStdString(rightRenderer.instructionText(inst));
+  };
+  auto leftLabel = [&](int labelId) {
+    return QString("#%1").arg(project->getLabelName(fileId, labelId));
+  };
+  auto rightLabel = [&](int labelId) { return QString("#%1").arg(labelId); };
+  auto labelAddress = [](const SCXFile *file, int labelId) {
+    return file->getLabelOffset(labelId);
+  };
+
+  int changed = 0;
+  for (const auto &label : diff.labels) {
+    switch (label.kind) {
+      case SC3LabelDiff::Unchanged:
+        continue;
+      case SC3LabelDiff::Removed:
+        addRow(leftLabel(label.oldLabelId), QString(), RemovedColor,
+               labelAddress(projectFile, label.oldLabelId));
+        for (const auto &inst :
+             projectFile->disassembly()[label.oldLabelId]->instructions())
+          addRow(leftText(inst.get()), QString(), RemovedColor,
+                 inst->position());
+        break;
+      case SC3LabelDiff::Added:
+        addRow(QString(), rightLabel(label.newLabelId), AddedColor, -1);
+        for (const auto &inst :
+             _otherFile->disassembly()[label.newLabelId]->instructions())
+          addRow(QString(), rightText(inst.get()), AddedColor, -1);
+        break;
+      case SC3LabelDiff::Changed:
+        addRow(leftLabel(label.oldLabelId), rightLabel(label.newLabelId),
+               LabelColor, labelAddress(projectFile, label.oldLabelId));
+        for (const auto &op : label.ops) {
+          if (op.kind == SC3InstructionDiffOp::Same)
+            addRow(leftText(op.oldInst), rightText(op.newInst), QColor(),
+                   op.oldInst->position());
+          else if (op.kind == SC3InstructionDiffOp::Removed)
+            addRow(leftText(op.oldInst), QString(), RemovedColor,
+                   op.oldInst->position());
+          else
+            addRow(QString(), rightText(op.newInst), AddedColor, -1);
+        }
+        break;
+    }
+    changed++;
+  }
+
+  if (changed == 0)
+    _statusLabel->setText("No differences");
+  else
+    _statusLabel->setText(
+        QString("%1 of %2 labels differ").arg(changed).arg(diff.labels.size()));
+
+  resize(1000, 600);
+}
+
+void ScriptDiffDialog::addRow(const QString &left, const QString &right,
+                              const QColor &color, SCXOffset address) {
+  int row = _table->rowCount();
+  _table->insertRow(row);
+  QTableWidgetItem *leftItem = new QTableWidgetItem(left);
+  QTableWidgetItem *rightItem = new QTableWidgetItem(right);
+  if (color.isValid()) {
+    leftItem->setBackground(color);
+    rightItem->setBackground(color);
+  }
+  _table->setItem(row, 0, leftItem);
+  _table->setItem(row, 1, rightItem);
+  _addresses.push_back(address);
+}
+
+void ScriptDiffDialog::goToRow(int row) {
+  if (row < 0 || row >= (int)_addresses.size() || _addresses[row] < 0) return;
+  dApp->project()->goToAddress(_fileId, _addresses[row]);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QDialog>
+#include <QLabel>
+#include <QTableWidget>
+#include <parser/SCXFile.h>
+#include <parser/SCXTypes.h>
+#include <memory>
+#include <vector>
+
+// Side-by-side diff of a project script against another version of it, e.g.
+// from a patch. Only labels that differ are listed.
+class ScriptDiffDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  // throws std::runtime_error if otherPath can't be read
+  explicit ScriptDiffDialog(int fileId, const QString &otherPath,
+                            QWidget *parent = 0);
+
+ private slots:
+  void goToRow(int row);
+
+ private:
+  int _fileId;
+  std::unique_ptr<SCXFile> _otherFile;
+
+  QLabel *_statusLabel;
+  QTableWidget *_table;
+
+  // per row, -1 if the project side is empty
+  std::vector<SCXOffset> _addresses;
+
+  void addRow(const QString &left, const QString &right, const QColor &color,
+              SCXOffset address);
+};
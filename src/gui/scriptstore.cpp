@@ -0,0 +1,59 @@
+#include "scriptstore.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <climits>
+#include <stdexcept>
+
+QString ScriptStore::hashFor(const uint8_t* data, int size) {
+  return QString::fromLatin1(
+      QCryptographicHash::hash(QByteArray::fromRawData((const char*)data, size),
+                               QCryptographicHash::Sha1)
+          .toHex());
+}
+
+QString ScriptStore::put(const uint8_t* data, int size) {
+  QString hash = hashFor(data, size);
+  QString path = pathFor(hash);
+  if (QFileInfo(path).size() == size) return hash;
+
+  if (!QDir().mkpath(_dir)) {
+    throw std::runtime_error("Couldn't create script store at " +
+                             _dir.toStdString());
+  }
+  // write to a temporary name first, so a crash never leaves a truncated
+  // script behind under its hash
+  QString tmpPath = path + ".tmp";
+  QFile out(tmpPath);
+  if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+      out.write((const char*)data, size) != size) {
+    out.remove();
+    throw std::runtime_error("Couldn't write " + tmpPath.toStdString());
+  }
+  out.close();
+  QFile::remove(path);
+  if (!QFile::rename(tmpPath, path)) {
+    QFile::remove(tmpPath);
+    throw std::runtime_error("Couldn't write " + path.toStdString());
+  }
+  return hash;
+}
+
+std::shared_ptr<QFile> ScriptStore::map(const QString& hash, uint8_t** data,
+                                        int* size) const {
+  std::shared_ptr<QFile> file = std::make_shared<QFile>(pathFor(hash));
+  if (!file->open(QIODevice::ReadOnly)) return nullptr;
+  qint64 length = file->size();
+  if (length <= 0 || length > INT_MAX) return nullptr;
+  uchar* mapped = file->map(0, length);
+  if (mapped == nullptr) return nullptr;
+  // the mapping outlives close()
+  file->close();
+  *data = mapped;
+  *size = (int)length;
+  return file;
+}
+
+QString ScriptStore::pathFor(const QString& hash) const {
+  return _dir + "/" + hash + ".scx";
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <QFile>
+#include <QString>
+
+// Content-addressed storage for script files, kept in a directory next to the
+// project database. Scripts are named by their SHA-1, so identical scripts are
+// only stored once no matter how many projects use them, and are mapped into
+// memory instead of being read through the database.
+class ScriptStore {
+ public:
+  explicit ScriptStore(const QString& dir) : _dir(dir) {}
+
+  const QString& dir() const { return _dir; }
+
+  static QString hashFor(const uint8_t* data, int size);
+
+  // returns the hash. throws std::runtime_error if the script can't be
+  // written.
+  QString put(const uint8_t* data, int size);
+
+  // Maps the script read-only. The mapping lives as long as the returned
+  // file, *data and *size are only set on success.
+  std::shared_ptr<QFile> map(const QString& hash, uint8_t** data,
+                             int* size) const;
+
+ private:
+  QString _dir;
+
+  QString pathFor(const QString& hash) const;
+};
@@ -0,0 +1,115 @@
+#include "stringindex.h"
+#include <algorithm>
+#include <iterator>
+
+void StringIndex::add(int fileId, int stringId, const QString& text) {
+  uint32_t entry = (uint32_t)_entries.size();
+  QString caseFolded = text.toCaseFolded();
+  if (caseFolded == text) caseFolded = text;
+  _entries.push_back({fileId, stringId, text, caseFolded});
+  const QString& folded = _entries.back().folded;
+
+  std::vector<uint32_t> bigrams;
+  bigrams.reserve(folded.size());
+  for (int i = 0; i + 1 < folded.size(); i++)
+    bigrams.push_back(bigramAt(folded, i));
+  std::sort(bigrams.begin(), bigrams.end());
+  bigrams.erase(std::unique(bigrams.begin(), bigrams.end()), bigrams.end());
+  for (uint32_t bigram : bigrams) _pending.emplace_back(bigram, entry);
+}
+
+void StringIndex::build() {
+  if (_pending.empty()) return;
+
+  // merge with what's already built so build() can be called repeatedly
+  std::vector<std::pair<uint32_t, uint32_t>> all;
+  all.reserve(_postings.size() + _pending.size());
+  for (size_t i = 0; i < _bigrams.size(); i++) {
+    for (uint32_t j = _offsets[i]; j < _offsets[i + 1]; j++)
+      all.emplace_back(_bigrams[i], _postings[j]);
+  }
+  std::move(_pending.begin(), _pending.end(), std::back_inserter(all));
+  _pending.clear();
+  _pending.shrink_to_fit();
+  std::sort(all.begin(), all.end());
+
+  _bigrams.clear();
+  _offsets.clear();
+  _postings.clear();
+  _postings.reserve(all.size());
+  for (const auto& posting : all) {
+    if (_bigrams.empty() || _bigrams.back() != posting.first) {
+      _bigrams.push_back(posting.first);
+      _offsets.push_back((uint32_t)_postings.size());
+    }
+    _postings.push_back(posting.second);
+  }
+  _offsets.push_back((uint32_t)_postings.size());
+  _bigrams.shrink_to_fit();
+  _offsets.shrink_to_fit();
+}
+
+void StringIndex::clear() {
+  _entries.clear();
+  _bigrams.clear();
+  _offsets.clear();
+  _postings.clear();
+  _pending.clear();
+}
+
+std::vector<StringIndex::Hit> StringIndex::search(const QString& query,
+                                                  int maxHits) const {
+  std::vector<Hit> result;
+  QString folded = query.toCaseFolded();
+  if (folded.isEmpty()) return result;
+
+  auto addHit = [&](uint32_t entry) {
+    const Entry& e = _entries[entry];
+    if (!e.folded.contains(folded)) return true;
+    result.push_back({e.fileId, e.stringId, e.text});
+    return maxHits < 0 || (int)result.size() < maxHits;
+  };
+
+  // nothing to look up for single characters
+  if (folded.size() < 2) {
+    for (uint32_t i = 0; i < _entries.size(); i++) {
+      if (!addHit(i)) break;
+    }
+    return result;
+  }
+
+  // posting lists of all distinct bigrams, shortest first
+  std::vector<std::pair<const uint32_t*, const uint32_t*>> lists;
+  std::vector<uint32_t> bigrams;
+  for (int i = 0; i + 1 < folded.size(); i++)
+    bigrams.push_back(bigramAt(folded, i));
+  std::sort(bigrams.begin(), bigrams.end());
+  bigrams.erase(std::unique(bigrams.begin(), bigrams.end()), bigrams.end());
+  for (uint32_t bigram : bigrams) {
+    auto it = std::lower_bound(_bigrams.begin(), _bigrams.end(), bigram);
+    if (it == _bigrams.end() || *it != bigram) return result;
+    size_t i = it - _bigrams.begin();
+    lists.emplace_back(_postings.data() + _offsets[i],
+                       _postings.data() + _offsets[i + 1]);
+  }
+  std::sort(lists.begin(), lists.end(),
+            [](const std::pair<const uint32_t*, const uint32_t*>& a,
+               const std::pair<const uint32_t*, const uint32_t*>& b) {
+              return a.second - a.first < b.second - b.first;
+            });
+
+  std::vector<uint32_t> candidates(lists[0].first, lists[0].second);
+  for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+    std::vector<uint32_t> both;
+    std::set_intersection(candidates.begin(), candidates.end(),
+                          lists[i].first, lists[i].second,
+                          std::back_inserter(both));
+    candidates.swap(both);
+  }
+
+  // bigrams can match out of order, so check the actual text
+  for (uint32_t entry : candidates) {
+    if (!addHit(entry)) break;
+  }
+  return result;
+}
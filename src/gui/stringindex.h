@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <QString>
+
+// In-memory full-text index over decoded script strings. Text is split into
+// overlapping character bigrams rather than words, which works the same for
+// CJK text (no spaces) as for anything else. A query only has to verify the
+// strings that contain all of its bigrams.
+class StringIndex {
+ public:
+  struct Hit {
+    int fileId;
+    int stringId;
+    // as added, shared with the index
+    QString text;
+  };
+
+  void add(int fileId, int stringId, const QString& text);
+  // call after adding strings, before searching
+  void build();
+  void clear();
+
+  // case-insensitive substring search, in (fileId, stringId) insertion order.
+  // maxHits < 0 means no limit
+  std::vector<Hit> search(const QString& query, int maxHits = -1) const;
+
+ private:
+  struct Entry {
+    int fileId;
+    int stringId;
+    QString text;
+    // shares text's data when folding changes nothing
+    QString folded;
+  };
+
+  static uint32_t bigramAt(const QString& text, int i) {
+    return ((uint32_t)text[i].unicode() << 16) | text[i + 1].unicode();
+  }
+
+  std::vector<Entry> _entries;
+  // CSR: sorted bigrams, offsets into _postings (entry indices, ascending)
+  std::vector<uint32_t> _bigrams;
+  std::vector<uint32_t> _offsets;
+  std::vector<uint32_t> _postings;
+  std::vector<std::pair<uint32_t, uint32_t>> _pending;
+};
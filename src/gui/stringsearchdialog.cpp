@@ -0,0 +1,63 @@
+#include "stringsearchdialog.h"
+#include "debuggerapplication.h"
+#include "project.h"
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+StringSearchDialog::StringSearchDialog(QWidget *parent) : QDialog(parent) {
+  setWindowTitle("Find text");
+
+  _queryEdit = new QLineEdit(this);
+  _queryEdit->setPlaceholderText("Text to search for");
+  connect(_queryEdit, &QLineEdit::textChanged, this,
+          &StringSearchDialog::search);
+
+  _model = new StringSearchModel(this);
+  _table = new QTableView(this);
+  _table->setModel(_model);
+  QHeaderView *header = _table->horizontalHeader();
+  header->setSectionsMovable(false);
+  header->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+  header->setSectionResizeMode(1, QHeaderView::Stretch);
+  _table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  _table->setSelectionBehavior(QAbstractItemView::SelectRows);
+  _table->setSelectionMode(QAbstractItemView::SingleSelection);
+  _table->verticalHeader()->setVisible(false);
+  connect(_table, &QTableView::doubleClicked, this,
+          &StringSearchDialog::accept);
+
+  _buttons =
+      new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+  connect(_buttons, &QDialogButtonBox::accepted, this,
+          &StringSearchDialog::accept);
+  connect(_buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addWidget(_queryEdit);
+  layout->addWidget(_table);
+  layout->addWidget(_buttons);
+  setLayout(layout);
+
+  resize(700, 400);
+}
+
+void StringSearchDialog::search(const QString &query) {
+  if (query.isEmpty()) {
+    _model->setHits({});
+    return;
+  }
+  _model->setHits(dApp->project()->searchStrings(query, MaxHits));
+}
+
+void StringSearchDialog::accept() {
+  const StringIndex::Hit *hit = _model->hitForIndex(_table->currentIndex());
+  if (hit == nullptr) return;
+  int fileId = hit->fileId;
+  int stringId = hit->stringId;
+
+  // strings nothing refers to have nowhere to go to
+  auto refs = dApp->project()->getStringRefs(fileId, stringId);
+  if (refs.empty()) return;
+  QDialog::accept();
+  dApp->project()->goToAddress(refs.front().first, refs.front().second);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QLineEdit>
+#include "stringsearchmodel.h"
+#include <QTableView>
+
+class StringSearchDialog : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit StringSearchDialog(QWidget *parent = 0);
+
+ public slots:
+  void accept() override;
+
+ private slots:
+  void search(const QString &query);
+
+ private:
+  // more is rarely useful to scroll through
+  static const int MaxHits = 1000;
+
+  QLineEdit *_queryEdit;
+  StringSearchModel *_model;
+  QTableView *_table;
+  QDialogButtonBox *_buttons;
+};
@@ -0,0 +1,59 @@
+#include "stringsearchmodel.h"
+#include "debuggerapplication.h"
+#include "project.h"
+
+StringSearchModel::StringSearchModel(QObject *parent)
+    : QAbstractTableModel(parent) {}
+
+void StringSearchModel::setHits(std::vector<StringIndex::Hit> hits) {
+  beginResetModel();
+  _hits = std::move(hits);
+  endResetModel();
+}
+
+const StringIndex::Hit *StringSearchModel::hitForIndex(
+    const QModelIndex &index) const {
+  if (!index.isValid() || index.row() >= (int)_hits.size()) return nullptr;
+  return &_hits[index.row()];
+}
+
+int StringSearchModel::columnCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  return (int)ColumnType::NumColumns;
+}
+
+int StringSearchModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  return (int)_hits.size();
+}
+
+QVariant StringSearchModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || role != Qt::DisplayRole) return QVariant();
+  const StringIndex::Hit &hit = _hits[index.row()];
+  switch ((ColumnType)index.column()) {
+    case ColumnType::Script:
+      return QString("%1#%2")
+          .arg(QString::fromStdString(
+              dApp->project()->files().at(hit.fileId)->getName()))
+          .arg(hit.stringId);
+    case ColumnType::Text:
+      return hit.text;
+    default:
+      return QVariant();
+  }
+}
+
+QVariant StringSearchModel::headerData(int section,
+                                       Qt::Orientation orientation,
+                                       int role) const {
+  if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+    return QVariant();
+  switch ((ColumnType)section) {
+    case ColumnType::Script:
+      return QVariant("Script");
+    case ColumnType::Text:
+      return QVariant("Text");
+    default:
+      return QVariant();
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <QAbstractTableModel>
+#include <QString>
+#include "stringindex.h"
+#include <vector>
+
+// String search hits as rows of (script#stringId, text). The text comes with
+// the hits, so nothing is looked up when a row is shown.
+class StringSearchModel : public QAbstractTableModel {
+  Q_OBJECT
+
+ public:
+  enum class ColumnType { Script, Text, NumColumns };
+
+  explicit StringSearchModel(QObject *parent = 0);
+
+  void setHits(std::vector<StringIndex::Hit> hits);
+  // nullptr for an invalid index
+  const StringIndex::Hit *hitForIndex(const QModelIndex &index) const;
+
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+
+ private:
+  std::vector<StringIndex::Hit> _hits;
+};
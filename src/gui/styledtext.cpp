@@ -0,0 +1,222 @@
+#include "styledtext.h"
+#include <QFontMetrics>
+#include <QRegExp>
+#include <algorithm>
+#include <cmath>
+
+// QTextDocument's default document margin, so rows keep their old size
+static const int DocumentMargin = 4;
+
+static QColor parseColor(const QString& value) {
+  QRegExp rgb("rgb\\(\\s*(\\d+)\\s*,\\s*(\\d+)\\s*,\\s*(\\d+)\\s*\\)");
+  if (rgb.exactMatch(value))
+    return QColor(rgb.cap(1).toInt(), rgb.cap(2).toInt(), rgb.cap(3).toInt());
+  return QColor(value);
+}
+
+void StyledTextRenderer::setStyleSheet(const QString& css) {
+  _rules.clear();
+  QString text = css;
+  QRegExp comment("/\\*.*\\*/");
+  comment.setMinimal(true);
+  text.remove(comment);
+
+  QRegExp selectorRe("\\.([\\w-]+)(?:\\s*>\\s*\\.([\\w-]+))?");
+  for (const QString& block : text.split('}', QString::SkipEmptyParts)) {
+    int brace = block.indexOf('{');
+    if (brace < 0) continue;
+
+    Style style;
+    for (const QString& decl :
+         block.mid(brace + 1).split(';', QString::SkipEmptyParts)) {
+      int colon = decl.indexOf(':');
+      if (colon < 0) continue;
+      QString key = decl.left(colon).trimmed();
+      QString value = decl.mid(colon + 1).trimmed();
+      if (key == "color")
+        style.color = parseColor(value);
+      else if (key == "font-weight")
+        style.weight = value == "bold" ? QFont::Bold : QFont::Normal;
+      else if (key == "font-style")
+        style.italic = value == "italic";
+      else if (key == "margin-left")
+        style.marginLeft = value.remove("px").toInt();
+      else if (key == "margin-right")
+        style.marginRight = value.remove("px").toInt();
+    }
+
+    for (const QString& selector :
+         block.left(brace).split(',', QString::SkipEmptyParts)) {
+      if (!selectorRe.exactMatch(selector.trimmed())) continue;
+      Rule rule;
+      rule.style = style;
+      if (selectorRe.cap(2).isEmpty()) {
+        rule.cls = selectorRe.cap(1);
+        rule.specificity = 1;
+      } else {
+        rule.parentClass = selectorRe.cap(1);
+        rule.cls = selectorRe.cap(2);
+        rule.specificity = 2;
+      }
+      _rules.push_back(rule);
+    }
+  }
+
+  // later and more specific rules win, so apply them last
+  std::stable_sort(_rules.begin(), _rules.end(),
+                   [](const Rule& a, const Rule& b) {
+                     return a.specificity < b.specificity;
+                   });
+}
+
+void StyledTextRenderer::applyRules(const QStringList& classes,
+                                    const QStringList& parentClasses,
+                                    Style& style) const {
+  for (const Rule& rule : _rules) {
+    if (!classes.contains(rule.cls)) continue;
+    if (!rule.parentClass.isEmpty() &&
+        !parentClasses.contains(rule.parentClass))
+      continue;
+    if (rule.style.color.isValid()) style.color = rule.style.color;
+    if (rule.style.weight >= 0) style.weight = rule.style.weight;
+    if (rule.style.italic >= 0) style.italic = rule.style.italic;
+    if (rule.style.marginLeft) style.marginLeft = rule.style.marginLeft;
+    if (rule.style.marginRight) style.marginRight = rule.style.marginRight;
+  }
+}
+
+static void decodeEntities(QString& text) {
+  if (!text.contains('&')) return;
+  text.replace("&lt;", "<");
+  text.replace("&gt;", ">");
+  text.replace("&quot;", "\"");
+  text.replace("&apos;", "'");
+  text.replace("&#39;", "'");
+  text.replace("&amp;", "&");
+}
+
+StyledTextRenderer::Layout StyledTextRenderer::layout(
+    const QString& html, const QFont& baseFont,
+    const QColor& baseColor) const {
+  struct Element {
+    QStringList classes;
+    Style style;
+    bool isDiv;
+  };
+  std::vector<Element> stack;
+  Element root;
+  root.style.color = baseColor;
+  root.style.weight = baseFont.weight();
+  root.style.italic = baseFont.italic();
+  root.isDiv = false;
+  stack.push_back(root);
+
+  Layout result;
+  qreal x = DocumentMargin;
+  int lineHeight = QFontMetrics(baseFont).height();
+
+  // consecutive text in the same style becomes one span
+  QString run;
+  QFont runFont;
+  QColor runColor;
+  auto flush = [&]() {
+    if (run.isEmpty()) return;
+    Span span;
+    span.pos = QPointF(x, DocumentMargin);
+    span.text.setText(run);
+    span.text.setTextFormat(Qt::PlainText);
+    span.text.setPerformanceHint(QStaticText::AggressiveCaching);
+    span.text.prepare(QTransform(), runFont);
+    span.font = runFont;
+    span.color = runColor;
+    x += span.text.size().width();
+    lineHeight = std::max(lineHeight, QFontMetrics(runFont).height());
+    result.spans.push_back(std::move(span));
+    run.clear();
+  };
+
+  bool lastWasSpace = false;
+  int pos = 0;
+  while (pos < html.size()) {
+    if (html[pos] == '<') {
+      int end = html.indexOf('>', pos);
+      if (end < 0) break;
+      QString tag = html.mid(pos + 1, end - pos - 1);
+      pos = end + 1;
+
+      if (tag.startsWith('/')) {
+        if (stack.size() <= 1) continue;
+        if (stack.back().isDiv) {
+          flush();
+          x += stack.back().style.marginRight;
+        }
+        stack.pop_back();
+        continue;
+      }
+      if (tag == "br") {
+        run += ' ';
+        continue;
+      }
+
+      Element element;
+      element.isDiv = tag.startsWith("div");
+      int quote = tag.indexOf('\'');
+      if (quote >= 0) {
+        int endQuote = tag.indexOf('\'', quote + 1);
+        element.classes = tag.mid(quote + 1, endQuote - quote - 1)
+                              .split(' ', QString::SkipEmptyParts);
+      }
+      const Style& parent = stack.back().style;
+      element.style.color = parent.color;
+      element.style.weight = parent.weight;
+      element.style.italic = parent.italic;
+      applyRules(element.classes, stack.back().classes, element.style);
+      if (element.isDiv && element.style.marginLeft) {
+        flush();
+        x += element.style.marginLeft;
+      }
+      stack.push_back(element);
+      continue;
+    }
+
+    int end = html.indexOf('<', pos);
+    if (end < 0) end = html.size();
+    QString text = html.mid(pos, end - pos);
+    pos = end;
+    decodeEntities(text);
+
+    const Style& style = stack.back().style;
+    QFont font = baseFont;
+    font.setWeight(style.weight);
+    font.setItalic(style.italic != 0);
+    if (!run.isEmpty() && (font != runFont || style.color != runColor))
+      flush();
+    runFont = font;
+    runColor = style.color;
+    // whitespace collapses like it would in HTML
+    for (QChar c : text) {
+      if (c.isSpace()) {
+        if (lastWasSpace) continue;
+        lastWasSpace = true;
+        run += ' ';
+      } else {
+        lastWasSpace = false;
+        run += c;
+      }
+    }
+  }
+  flush();
+
+  result.size = QSize((int)std::ceil(x) + DocumentMargin,
+                      lineHeight + 2 * DocumentMargin);
+  return result;
+}
+
+void StyledTextRenderer::draw(QPainter* painter, const QPoint& origin,
+                              const Layout& layout) {
+  for (const Span& span : layout.spans) {
+    painter->setFont(span.font);
+    painter->setPen(span.color);
+    painter->drawStaticText(origin + span.pos, span.text);
+  }
+}
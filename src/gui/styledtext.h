@@ -0,0 +1,58 @@
+#pragma once
+#include <QColor>
+#include <QFont>
+#include <QPainter>
+#include <QPointF>
+#include <QSize>
+#include <QStaticText>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+// Lays out the markup the disassembly views produce (nested span/div elements
+// with classes, as in textdump.cpp) without QTextDocument. Class rules come
+// from the application style sheet: .class and .parent>.class selectors with
+// color, font-weight, font-style and margin-left/right, which is all
+// stylesheet.qss uses for them.
+class StyledTextRenderer {
+ public:
+  struct Span {
+    QPointF pos;
+    QStaticText text;
+    QFont font;
+    QColor color;
+  };
+  struct Layout {
+    std::vector<Span> spans;
+    QSize size;
+  };
+
+  void setStyleSheet(const QString& css);
+
+  // html must be well-formed, only span/div/br tags and entities are known
+  Layout layout(const QString& html, const QFont& baseFont,
+                const QColor& baseColor) const;
+  static void draw(QPainter* painter, const QPoint& origin,
+                   const Layout& layout);
+
+ private:
+  struct Style {
+    QColor color;
+    int weight = -1;
+    int italic = -1;
+    int marginLeft = 0;
+    int marginRight = 0;
+  };
+  struct Rule {
+    // empty if the selector doesn't have one
+    QString parentClass;
+    QString cls;
+    Style style;
+    int specificity;
+  };
+  // in the order they apply
+  std::vector<Rule> _rules;
+
+  void applyRules(const QStringList& classes, const QStringList& parentClasses,
+                  Style& style) const;
+};
@@ -1,6 +1,4 @@
 #include "textdump.h"
-#include <iomanip>
-#include <sstream>
 #include <string>
 
 #include "parser/SC3Argument.h"
@@ -10,21 +8,92 @@
 
 #include "parser/IContextProvider.h"
 
-#include "guiutil.h"
+SC3TextRenderer::SC3TextRenderer(bool richText, IContextProvider *ctx,
+                                 int fileId)
+    : _richText(richText), _ctx(ctx), _fileId(fileId), _out(&_buffer) {}
 
-// TODO this could go into a per-file textifier class, held by DisassemblyModel,
-// really
+const std::string &SC3TextRenderer::instructionText(
+    const SC3Instruction *inst) {
+  // clear() keeps the capacity, so this stops allocating after a while
+  _buffer.clear();
+  _out = &_buffer;
+  instruction(inst);
+  return _buffer;
+}
+
+void SC3TextRenderer::appendInstruction(std::string &out,
+                                        const SC3Instruction *inst) {
+  _out = &out;
+  instruction(inst);
+  _out = &_buffer;
+}
+
+void SC3TextRenderer::openSpan(const char *cssClass) {
+  *_out += "<span class='";
+  *_out += cssClass;
+  *_out += "'>";
+}
+
+void SC3TextRenderer::closeSpan() { *_out += "</span>"; }
+
+void SC3TextRenderer::number(long long value) {
+  char digits[24];
+  int i = sizeof(digits);
+  unsigned long long magnitude =
+      value < 0 ? 0ULL - (unsigned long long)value : value;
+  do {
+    digits[--i] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (value < 0) digits[--i] = '-';
+  _out->append(digits + i, sizeof(digits) - i);
+}
+
+void SC3TextRenderer::escaped(const std::string &text) {
+  for (char ch : text) {
+    switch (ch) {
+      case '&':
+        *_out += "&amp;";
+        break;
+      case '\'':
+        *_out += "&apos;";
+        break;
+      case '"':
+        *_out += "&quot;";
+        break;
+      case '<':
+        *_out += "&lt;";
+        break;
+      case '>':
+        *_out += "&gt;";
+        break;
+      default:
+        *_out += ch;
+        break;
+    }
+  }
+}
+
+void SC3TextRenderer::name(const std::string &name, int id,
+                           const char *nameClass) {
+  if (_richText) {
+    if (name == std::to_string(id))
+      openSpan("number");
+    else
+      openSpan(nameClass);
+  }
+  *_out += name;
+  if (_richText) closeSpan();
+}
 
-std::string SC3ExpressionNodeToString(bool richText, IContextProvider *ctx,
-                                      int fileId,
-                                      const SC3ExpressionNode *node) {
-  std::stringstream _s;
+void SC3TextRenderer::expressionNode(const SC3ExpressionNode *node) {
+  if (node == nullptr) return;
   const OpInfo &thisOp = OperatorInfos.at(node->type);
   switch (node->type) {
     case ImmediateValue: {
-      if (richText) _s << "<span class='number'>";
-      _s << std::to_string(node->value);
-      if (richText) _s << "</span>";
+      if (_richText) openSpan("number");
+      number(node->value);
+      if (_richText) closeSpan();
       break;
     }
     case Multiply:
@@ -56,381 +125,318 @@ std::string SC3ExpressionNodeToString(bool richText, IContextProvider *ctx,
     case BitwiseXorAssign: {
       const OpInfo &lhsOp = OperatorInfos.at(node->lhs->type);
       const OpInfo &rhsOp = OperatorInfos.at(node->rhs->type);
-      if (lhsOp.precedence < thisOp.precedence ||
-          (lhsOp.precedence == thisOp.precedence && thisOp.rightAssociative)) {
-        _s << "("
-           << SC3ExpressionNodeToString(richText, ctx, fileId, node->lhs.get())
-           << ")";
+      bool lhsParens =
+          lhsOp.precedence < thisOp.precedence ||
+          (lhsOp.precedence == thisOp.precedence && thisOp.rightAssociative);
+      bool rhsParens =
+          rhsOp.precedence < thisOp.precedence ||
+          (rhsOp.precedence == thisOp.precedence && !thisOp.rightAssociative);
+      if (lhsParens) *_out += '(';
+      expressionNode(node->lhs.get());
+      if (lhsParens) *_out += ')';
+      *_out += ' ';
+      if (_richText) {
+        openSpan("operator");
+        escaped(thisOp.str);
+        closeSpan();
       } else {
-        _s << SC3ExpressionNodeToString(richText, ctx, fileId, node->lhs.get());
-      }
-      _s << " ";
-      if (richText) _s << "<span class='operator'>";
-      if (richText)
-        _s << htmlEscape(thisOp.str);
-      else
-        _s << thisOp.str;
-      if (richText) _s << "</span>";
-      _s << " ";
-      if (rhsOp.precedence < thisOp.precedence ||
-          (rhsOp.precedence == thisOp.precedence && !thisOp.rightAssociative)) {
-        _s << "("
-           << SC3ExpressionNodeToString(richText, ctx, fileId, node->rhs.get())
-           << ")";
-      } else {
-        _s << SC3ExpressionNodeToString(richText, ctx, fileId, node->rhs.get());
+        *_out += thisOp.str;
       }
+      *_out += ' ';
+      if (rhsParens) *_out += '(';
+      expressionNode(node->rhs.get());
+      if (rhsParens) *_out += ')';
       break;
     }
     case Increment:
     case Decrement: {
       const OpInfo &lhsOp = OperatorInfos.at(node->lhs->type);
-      if (thisOp.precedence < lhsOp.precedence) {
-        _s << "("
-           << SC3ExpressionNodeToString(richText, ctx, fileId, node->lhs.get())
-           << ")";
-      } else {
-        _s << SC3ExpressionNodeToString(richText, ctx, fileId, node->lhs.get());
-      }
-      if (richText) _s << "<span class='operator'>";
-      _s << thisOp.str;
-      if (richText) _s << "</span>";
+      bool lhsParens = thisOp.precedence < lhsOp.precedence;
+      if (lhsParens) *_out += '(';
+      expressionNode(node->lhs.get());
+      if (lhsParens) *_out += ')';
+      if (_richText) openSpan("operator");
+      *_out += thisOp.str;
+      if (_richText) closeSpan();
       break;
     }
     case FuncUnk2F:
     case FuncUnk30:
     case FuncNop31:
     case FuncNop32: {
-      if (richText) _s << "<span class='func'>";
-      _s << thisOp.str;
-      if (richText) _s << "</span>";
+      if (_richText) openSpan("func");
+      *_out += thisOp.str;
+      if (_richText) closeSpan();
       break;
     }
     case FuncGlobalVars:
     case FuncFlags:
     case FuncLabelTable:
-      if (richText) _s << "<span class='" << thisOp.str << "'>";
-      _s << thisOp.str;
-      if (richText) _s << "</span>";
-      _s << "[";
-      if (ctx == nullptr || node->rhs->type != ImmediateValue) {
-        _s << SC3ExpressionNodeToString(richText, ctx, fileId, node->rhs.get());
+      if (_richText) openSpan(thisOp.str.c_str());
+      *_out += thisOp.str;
+      if (_richText) closeSpan();
+      *_out += '[';
+      if (_ctx == nullptr || node->rhs->type != ImmediateValue) {
+        expressionNode(node->rhs.get());
       } else {
-        std::string name;
+        int id = node->rhs->value;
+        std::string nameClass = thisOp.str + "_name";
         switch (node->type) {
           case FuncGlobalVars:
-            name = ctx->globalVarName(node->rhs->value);
+            name(_ctx->globalVarName(id), id, nameClass.c_str());
             break;
           case FuncFlags:
-            name = ctx->flagName(node->rhs->value);
+            name(_ctx->flagName(id), id, nameClass.c_str());
             break;
           case FuncLabelTable:
-            name = "#" + ctx->labelName(fileId, node->rhs->value);
+            name("#" + _ctx->labelName(_fileId, id), id, nameClass.c_str());
             break;
           default:
             break;
         }
-        if (richText) {
-          if (name == std::to_string(node->rhs->value))
-            _s << "<span class='number'>";
-          else
-            _s << "<span class='" << thisOp.str << "_name'>";
-        }
-        _s << name;
-        if (richText) _s << "</span>";
       }
-      _s << "]";
+      *_out += ']';
       break;
     case FuncThreadVars:
-      if (richText) _s << "<span class='" << thisOp.str << "'>";
-      _s << thisOp.str;
-      if (richText) _s << "</span>";
-      _s << "[" +
-                SC3ExpressionNodeToString(richText, ctx, fileId,
-                                          node->rhs.get()) +
-                "]";
+      if (_richText) openSpan(thisOp.str.c_str());
+      *_out += thisOp.str;
+      if (_richText) closeSpan();
+      *_out += '[';
+      expressionNode(node->rhs.get());
+      *_out += ']';
       break;
     case Negation:
     case FuncRandom: {
-      if (richText) {
-        if (node->type == Negation)
-          _s << "<span class='operator'>";
-        else
-          _s << "<span class='func'>";
-      }
-      _s << thisOp.str;
-      if (richText) _s << "</span>";
-      _s << "(" +
-                SC3ExpressionNodeToString(richText, ctx, fileId,
-                                          node->rhs.get()) +
-                ")";
+      if (_richText) openSpan(node->type == Negation ? "operator" : "func");
+      *_out += thisOp.str;
+      if (_richText) closeSpan();
+      *_out += '(';
+      expressionNode(node->rhs.get());
+      *_out += ')';
       break;
     }
     case FuncDataAccess:
     case FuncFarLabelTable:
     case FuncDMA: {
-      if (richText) _s << "<span class='func'>";
-      _s << thisOp.str;
-      if (richText) _s << "</span>";
-      _s << "(" +
-                SC3ExpressionNodeToString(richText, ctx, fileId,
-                                          node->lhs.get()) +
-                ", " +
-                SC3ExpressionNodeToString(richText, ctx, fileId,
-                                          node->rhs.get()) +
-                ")";
+      if (_richText) openSpan("func");
+      *_out += thisOp.str;
+      if (_richText) closeSpan();
+      *_out += '(';
+      expressionNode(node->lhs.get());
+      *_out += ", ";
+      expressionNode(node->rhs.get());
+      *_out += ')';
       break;
     }
-    default: { return ""; }
+    default:
+      break;
   }
-  return _s.str();
 }
 
-std::string SC3ExpressionToString(bool richText, IContextProvider *ctx,
-                                  int fileId, const SC3Expression &expr) {
-  auto root = expr.simplified();
-  return SC3ExpressionNodeToString(richText, ctx, fileId, root);
+void SC3TextRenderer::varRefArgument(const SC3Argument &arg,
+                                     const char *argClass,
+                                     const char *funcClass,
+                                     const char *funcName,
+                                     const char *nameClass, bool isFlag) {
+  const SC3ExpressionNode *root = arg.exprValue.simplified();
+  if (_richText) openSpan(argClass);
+  if (_richText) openSpan(funcClass);
+  *_out += funcName;
+  if (_richText) closeSpan();
+  *_out += '(';
+  if (_ctx != nullptr && root != nullptr && root->type == ImmediateValue) {
+    name(isFlag ? _ctx->flagName(root->value)
+                : _ctx->globalVarName(root->value),
+         root->value, nameClass);
+  } else {
+    if (_richText) openSpan("expr");
+    expressionNode(root);
+    if (_richText) closeSpan();
+  }
+  *_out += ')';
+  if (_richText) closeSpan();
 }
 
-std::string SC3ArgumentToString(bool richText, IContextProvider *ctx,
-                                int fileId, const SC3Argument &arg) {
-  std::stringstream out;
+void SC3TextRenderer::argument(const SC3Argument &arg) {
   switch (arg.type) {
     case ByteArray: {
-      if (richText) out << "<span class='byteArrayArg'>";
-      out << uint8_vector_to_hex_string(arg.byteArrayValue);
-      if (richText) out << "</span>";
+      static const char hexDigits[] = "0123456789abcdef";
+      if (_richText) openSpan("byteArrayArg");
+      for (size_t i = 0; i < arg.byteArrayValue.size(); i++) {
+        if (i > 0) *_out += ' ';
+        *_out += hexDigits[arg.byteArrayValue[i] >> 4];
+        *_out += hexDigits[arg.byteArrayValue[i] & 0xF];
+      }
+      if (_richText) closeSpan();
       break;
     }
     case Byte: {
-      if (richText) out << "<span class='byteArg number'>";
-      out << std::to_string((unsigned)arg.byteValue);
-      if (richText) out << "</span>";
+      if (_richText) openSpan("byteArg number");
+      number(arg.byteValue);
+      if (_richText) closeSpan();
       break;
     }
     case UInt16: {
-      if (richText) out << "<span class='uint16Arg number'>";
-      out << std::to_string((unsigned)arg.uint16_value);
-      if (richText) out << "</span>";
+      if (_richText) openSpan("uint16Arg number");
+      number(arg.uint16_value);
+      if (_richText) closeSpan();
       break;
     }
     case Expression: {
-      const auto &expr = arg.exprValue;
-      if (richText) out << "<span class='exprArg expr'>";
-      out << SC3ExpressionToString(richText, ctx, fileId, expr);
-      if (richText) out << "</span>";
+      if (_richText) openSpan("exprArg expr");
+      expressionNode(arg.exprValue.simplified());
+      if (_richText) closeSpan();
       break;
     }
     case LocalLabel: {
-      auto id = arg.uint16_value;
-      if (ctx != nullptr) {
-        if (richText)
-          out << "<span class='localLabelArg namedLabelArg LabelTable_name'>";
-        out << "#" + ctx->labelName(fileId, id);
-        if (richText) out << "</span>";
+      if (_ctx != nullptr) {
+        if (_richText)
+          openSpan("localLabelArg namedLabelArg LabelTable_name");
+        *_out += '#';
+        *_out += _ctx->labelName(_fileId, arg.uint16_value);
+        if (_richText) closeSpan();
       } else {
-        if (richText) out << "<span class='localLabelArg unnamedLabelArg'>";
-        out << "LocalLabelRef(";
-        if (richText) out << "<span class='number'>";
-        out << std::to_string(id);
-        if (richText) out << "</span>";
-        out << ")";
-        if (richText) out << "</span>";
+        if (_richText) openSpan("localLabelArg unnamedLabelArg");
+        *_out += "LocalLabelRef(";
+        if (_richText) openSpan("number");
+        number(arg.uint16_value);
+        if (_richText) closeSpan();
+        *_out += ')';
+        if (_richText) closeSpan();
       }
       break;
     }
     case FarLabel: {
-      const auto &expr = arg.exprValue;
-      auto id = arg.uint16_value;
-      if (richText) out << "<span class='farLabelArg unnamedLabelArg'>";
-      out << "FarLabelRef(";
-      if (richText) out << "<span class='expr'>";
-      out << SC3ExpressionToString(richText, ctx, fileId, expr);
-      if (richText) out << "</span>";
-      out << ", ";
-      if (richText) out << "<span class='number'>";
-      out << std::to_string(id);
-      if (richText) out << "</span>";
-      out << ")";
-      if (richText) out << "</span>";
-      break;
-    }
-    case ReturnAddress: {
-      auto id = arg.uint16_value;
-      if (richText) out << "<span class='returnAddressArg'>";
-      out << "ReturnAddressRef(";
-      if (richText) out << "<span class='number'>";
-      out << std::to_string(id);
-      if (richText) out << "</span>";
-      out << ")";
-      if (richText) out << "</span>";
+      if (_richText) openSpan("farLabelArg unnamedLabelArg");
+      *_out += "FarLabelRef(";
+      if (_richText) openSpan("expr");
+      expressionNode(arg.exprValue.simplified());
+      if (_richText) closeSpan();
+      *_out += ", ";
+      if (_richText) openSpan("number");
+      number(arg.uint16_value);
+      if (_richText) closeSpan();
+      *_out += ')';
+      if (_richText) closeSpan();
       break;
     }
+    case ReturnAddress:
     case StringRef: {
-      auto id = arg.uint16_value;
-      if (richText) out << "<span class='stringRefArg'>";
-      out << "StringRef(";
-      if (richText) out << "<span class='number'>";
-      out << std::to_string(id);
-      if (richText) out << "</span>";
-      out << ")";
-      if (richText) out << "</span>";
+      bool isString = arg.type == StringRef;
+      if (_richText) openSpan(isString ? "stringRefArg" : "returnAddressArg");
+      *_out += isString ? "StringRef(" : "ReturnAddressRef(";
+      if (_richText) openSpan("number");
+      number(arg.uint16_value);
+      if (_richText) closeSpan();
+      *_out += ')';
+      if (_richText) closeSpan();
       break;
     }
     case ExprFlagRef: {
-      const auto &expr = arg.exprValue;
-      if (richText) out << "<span class='exprFlagRefArg'>";
-      if (ctx != nullptr && expr.simplified()->type == ImmediateValue) {
-        if (richText) out << "<span class='flagRefFunc'>";
-        out << "FlagRef";
-        if (richText) out << "</span>";
-        out << "(";
-        auto name = ctx->flagName(expr.simplified()->value);
-        if (richText) {
-          if (name == std::to_string(expr.simplified()->value))
-            out << "<span class='number'>";
-          else
-            out << "<span class='Flags_name'>";
-        }
-        out << name;
-        if (richText) out << "</span>";
-        out << ")";
-      } else {
-        if (richText) out << "<span class='flagRefFunc'>";
-        out << "FlagRef";
-        if (richText) out << "</span>";
-        out << "(";
-        if (richText) out << "<span class='expr'>";
-        out << SC3ExpressionToString(richText, ctx, fileId, expr);
-        if (richText) out << "</span>";
-        out << ")";
-      }
-      if (richText) out << "</span>";
+      varRefArgument(arg, "exprFlagRefArg", "flagRefFunc", "FlagRef",
+                     "Flags_name", true);
       break;
     }
     case ExprGlobalVarRef: {
-      const auto &expr = arg.exprValue;
-      if (richText) out << "<span class='exprGlobalVarRefArg'>";
-      if (ctx != nullptr && expr.simplified()->type == ImmediateValue) {
-        if (richText) out << "<span class='globalVarRefFunc'>";
-        out << "GlobalVarRef";
-        if (richText) out << "</span>";
-        out << "(";
-        auto name = ctx->globalVarName(expr.simplified()->value);
-        if (richText) {
-          if (name == std::to_string(expr.simplified()->value))
-            out << "<span class='number'>";
-          else
-            out << "<span class='GlobalVars_name'>";
-        }
-        out << name;
-        if (richText) out << "</span>";
-        out << ")";
-      } else {
-        if (richText) out << "<span class='globalVarRefFunc'>";
-        out << "GlobalVarRef";
-        if (richText) out << "</span>";
-        out << "(";
-        if (richText) out << "<span class='expr'>";
-        out << SC3ExpressionToString(richText, ctx, fileId, expr);
-        if (richText) out << "</span>";
-        out << ")";
-      }
-      if (richText) out << "</span>";
+      varRefArgument(arg, "exprGlobalVarRefArg", "globalVarRefFunc",
+                     "GlobalVarRef", "GlobalVars_name", false);
       break;
     }
     case ExprThreadVarRef: {
-      const auto &expr = arg.exprValue;
-      if (richText) out << "<span class='exprThreadVarRefArg'>";
-      if (richText) out << "<span class='threadVarRefFunc'>";
-      out << "ThreadVarRef";
-      if (richText) out << "</span>";
-      out << "(";
-      if (richText) out << "<span class='expr'>";
-      out << SC3ExpressionToString(richText, ctx, fileId, expr);
-      if (richText) out << "</span>";
-      out << ")";
-      if (richText) out << "</span>";
+      if (_richText) openSpan("exprThreadVarRefArg");
+      if (_richText) openSpan("threadVarRefFunc");
+      *_out += "ThreadVarRef";
+      if (_richText) closeSpan();
+      *_out += '(';
+      if (_richText) openSpan("expr");
+      expressionNode(arg.exprValue.simplified());
+      if (_richText) closeSpan();
+      *_out += ')';
+      if (_richText) closeSpan();
+      break;
+    }
+    default: {
+      *_out += "unrecognized";
       break;
     }
-    default: { return "unrecognized"; }
   }
-  return out.str();
 }
 
-std::string DumpSC3InstructionToText(bool richText, IContextProvider *ctx,
-                                     int fileId, const SC3Instruction *inst) {
-  std::stringstream out;
+void SC3TextRenderer::instruction(const SC3Instruction *inst) {
   if (inst->name() == "Assign") {
-    if (richText) out << "<span class='InstAssign'>";
-    out << SC3ArgumentToString(richText, ctx, fileId, inst->args().at(0));
-    out << "</span>";
-  } else {
-    if (richText)
-      out << "<span class='Inst" << inst->name()
-          << "'><span class='instructionName'>";
-    out << inst->name();
-    if (richText) out << "</span>";
-    int i = 0;
-    int argCount = inst->args().size();
-    if (argCount > 0) {
-      out << "(";
-      for (const auto &arg : inst->args()) {
-        i++;
-        if (richText) out << "<span class='argName'>";
-        out << arg.name << ": ";
-        if (richText) out << "</span>";
-        out << SC3ArgumentToString(richText, ctx, fileId, arg);
-        if (i < argCount) out << ", ";
-      }
-      out << ")";
-      if (richText) out << "</span>";
+    if (_richText) openSpan("InstAssign");
+    argument(inst->args().at(0));
+    if (_richText) closeSpan();
+    return;
+  }
+
+  if (_richText) {
+    *_out += "<span class='Inst";
+    *_out += inst->name();
+    *_out += "'><span class='instructionName'>";
+  }
+  *_out += inst->name();
+  if (_richText) closeSpan();
+  const auto &args = inst->args();
+  if (!args.empty()) {
+    *_out += '(';
+    for (size_t i = 0; i < args.size(); i++) {
+      if (i > 0) *_out += ", ";
+      if (_richText) openSpan("argName");
+      *_out += args[i].name;
+      *_out += ": ";
+      if (_richText) closeSpan();
+      argument(args[i]);
     }
+    *_out += ')';
   }
-  return out.str();
+  if (_richText) closeSpan();
 }
 
-std::string DumpSCXFileToText(bool richText, IContextProvider *ctx,
-                              const SCXFile *file) {
-  std::stringstream out;
+void SC3TextRenderer::appendFile(std::string &out, const SCXFile *file) {
+  _out = &out;
 
-  if (richText)
-    out << "<html><head><title>" << file->getName()
-        << "</title><link rel='stylesheet' type='text/css' "
-           "href='sc3syntaxhighlight.css'></head><body>";
+  if (_richText) {
+    out += "<html><head><title>";
+    out += file->getName();
+    out +=
+        "</title><link rel='stylesheet' type='text/css' "
+        "href='sc3syntaxhighlight.css'></head><body>";
+  }
 
   for (const auto &label : file->disassembly()) {
-    if (richText)
-      out << "<br><br><div class='label'>";
-    else
-      out << "\n\n";
-
-    if (ctx != nullptr)
-      out << "#" << ctx->labelName(file->getId(), label->id()) << ":";
-    else
-      out << "#label" << label->id() << "_" << label->address() << ":";
-
-    if (richText)
-      out << "</div><br>";
-    else
-      out << "\n";
+    out += _richText ? "<br><br><div class='label'>" : "\n\n";
+    out += '#';
+    if (_ctx != nullptr) {
+      out += _ctx->labelName(file->getId(), label->id());
+    } else {
+      out += "label";
+      number(label->id());
+      out += '_';
+      number(label->address());
+    }
+    out += ':';
+    out += _richText ? "</div><br>" : "\n";
 
     for (const auto &inst : label->instructions()) {
-      if (richText)
-        out << "<div class='instruction'>";
-      else
-        out << "\t";
-
-      out << DumpSC3InstructionToText(richText, ctx, file->getId(), inst.get());
-
-      if (richText)
-        out << "</div><br>";
-      else
-        out << "\n";
+      out += _richText ? "<div class='instruction'>" : "\t";
+      instruction(inst.get());
+      out += _richText ? "</div><br>" : "\n";
     }
   }
 
-  if (richText) out << "</body></html>";
+  if (_richText) out += "</body></html>";
+  _out = &_buffer;
+}
 
-  return out.str();
-}
\ No newline at end of file
+std::string DumpSC3InstructionToText(bool richText, IContextProvider *ctx,
+                                     int fileId, const SC3Instruction *inst) {
+  return SC3TextRenderer(richText, ctx, fileId).instructionText(inst);
+}
+
+std::string DumpSCXFileToText(bool richText, IContextProvider *ctx,
+                              const SCXFile *file) {
+  std::string out;
+  SC3TextRenderer(richText, ctx, file->getId()).appendFile(out, file);
+  return out;
+}
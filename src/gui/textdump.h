@@ -2,10 +2,51 @@
 #include <string>
 
 class SCXFile;
+struct SC3Argument;
 class SC3Instruction;
 class IContextProvider;
+class SC3ExpressionNode;
+
+// Renders disassembly of one script to text or HTML. Everything is appended
+// to a single output string instead of being built up from temporaries, and
+// the renderer keeps its buffer between instructions, so keep one around
+// (e.g. per model) rather than calling the free functions below in a loop.
+class SC3TextRenderer {
+ public:
+  // ctx may be nullptr for unnamed output
+  SC3TextRenderer(bool richText, IContextProvider *ctx, int fileId);
+
+  // valid until the next call
+  const std::string &instructionText(const SC3Instruction *inst);
+
+  void appendInstruction(std::string &out, const SC3Instruction *inst);
+  // whole file, HTML document when rich
+  void appendFile(std::string &out, const SCXFile *file);
+
+ private:
+  bool _richText;
+  IContextProvider *_ctx;
+  int _fileId;
+  std::string _buffer;
+  // what the append functions below write to
+  std::string *_out;
+
+  void instruction(const SC3Instruction *inst);
+  void argument(const SC3Argument &arg);
+  void expressionNode(const SC3ExpressionNode *node);
+  void varRefArgument(const SC3Argument &arg, const char *argClass,
+                      const char *funcClass, const char *funcName,
+                      const char *nameClass, bool isFlag);
+
+  void openSpan(const char *cssClass);
+  void closeSpan();
+  void number(long long value);
+  void escaped(const std::string &text);
+  // span class='number' if name is just the id, nameClass otherwise
+  void name(const std::string &name, int id, const char *nameClass);
+};
 
 std::string DumpSCXFileToText(bool richText, IContextProvider *ctx,
                               const SCXFile *file);
 std::string DumpSC3InstructionToText(bool richText, IContextProvider *ctx,
-                                     int fileId, const SC3Instruction *inst);
\ No newline at end of file
+                                     int fileId, const SC3Instruction *inst);
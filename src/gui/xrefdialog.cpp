@@ -4,7 +4,6 @@
 #include "project.h"
 #include <QHeaderView>
 #include <QVBoxLayout>
-#include "viewhelper.h"
 
 XrefDialog::XrefDialog(int fileId, int labelIdOrAddress, bool isLabel,
                        QWidget *parent)
@@ -13,35 +12,15 @@ XrefDialog::XrefDialog(int fileId, int labelIdOrAddress, bool isLabel,
 
   if (isLabel) {
     // refs to label
-    QString inRefText = QString("#%1").arg(
-        dApp->project()->getLabelName(fileId, labelIdOrAddress));
-    int i = 0;
-    auto outLabelRefs = dApp->project()->getLabelRefs(fileId, labelIdOrAddress);
-    // also show the label itself
-    outLabelRefs.emplace_back(fileId, dApp->project()
-                                          ->files()[fileId]
-                                          ->disassembly()[labelIdOrAddress]
-                                          ->address());
-    addReferences(i, inRefText, outLabelRefs);
+    _model->addLabelRefs(fileId, labelIdOrAddress);
   } else {
     if (fileId < 0 || dApp->project()->files().count(fileId) == 0) return;
     const SCXFile *file = dApp->project()->files().at(fileId).get();
 
-    int i = 0;
-
-    auto inVarRefs = variableRefsAtAddress(file, labelIdOrAddress);
-    addVarRefs(i, inVarRefs);
-
-    auto inLabelRefs = localLabelRefsAtAddress(file, labelIdOrAddress);
-    for (int labelId : inLabelRefs) {
-      QString inRefText =
-          QString("#%1").arg(dApp->project()->getLabelName(fileId, labelId));
-      auto outLabelRefs = dApp->project()->getLabelRefs(fileId, labelId);
-      // also show the label itself
-      outLabelRefs.emplace_back(fileId,
-                                file->disassembly()[labelId]->address());
-      addReferences(i, inRefText, outLabelRefs);
-    }
+    for (const auto &var : variableRefsAtAddress(file, labelIdOrAddress))
+      _model->addVariableRefs(var.first, var.second);
+    for (int labelId : localLabelRefsAtAddress(file, labelIdOrAddress))
+      _model->addLabelRefs(fileId, labelId);
   }
 
   setupViewAfterData();
@@ -51,20 +30,29 @@ XrefDialog::XrefDialog(VariableRefType type, int var, QWidget *parent)
     : QDialog(parent) {
   setupViewBeforeData();
 
-  std::vector<std::pair<VariableRefType, int>> varVec;
-  varVec.emplace_back(type, var);
-  int i = 0;
-  addVarRefs(i, varVec);
+  _model->addVariableRefs(type, var);
+
+  setupViewAfterData();
+}
+
+XrefDialog::XrefDialog(CallDirection direction, int fileId, int labelId,
+                       QWidget *parent)
+    : QDialog(parent) {
+  setupViewBeforeData();
+
+  if (direction == CallDirection::Callers)
+    _model->addCallers(fileId, labelId);
+  else
+    _model->addCallees(fileId, labelId);
 
   setupViewAfterData();
 }
 
 void XrefDialog::setupViewBeforeData() {
-  _table = new QTableWidget(this);
+  _model = new XrefModel(this);
+  _table = new QTableView(this);
+  _table->setModel(_model);
 
-  _table->setColumnCount(2);
-  _table->setHorizontalHeaderLabels(QStringList() << "Item"
-                                                  << "Referenced at");
   _table->horizontalHeader()->setSectionsMovable(false);
   _table->horizontalHeader()->setSectionsClickable(true);
   // TODO user resizable
@@ -73,6 +61,9 @@ void XrefDialog::setupViewBeforeData() {
   _table->setSelectionBehavior(QAbstractItemView::SelectRows);
   _table->setSelectionMode(QAbstractItemView::SingleSelection);
   _table->verticalHeader()->setVisible(false);
+  // rows all look alike, so don't ask each one for its height
+  _table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  _table->setWordWrap(false);
 
   _buttons =
       new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
@@ -84,9 +75,9 @@ void XrefDialog::setupViewBeforeData() {
   layout->addWidget(_buttons);
   setLayout(layout);
 
-  resize(500, 300);
+  resize(700, 300);
 
-  connect(_table, &QTableWidget::itemDoubleClicked, this, &XrefDialog::accept);
+  connect(_table, &QTableView::doubleClicked, this, &XrefDialog::accept);
 }
 
 void XrefDialog::setupViewAfterData() {
@@ -95,45 +86,8 @@ void XrefDialog::setupViewAfterData() {
   _table->horizontalHeader()->setSortIndicator(0, Qt::AscendingOrder);
 }
 
-void XrefDialog::addReferences(
-    int &i, const QString &inRefText,
-    const std::vector<std::pair<int, SCXOffset>> &outRefs) {
-  for (const auto &outRef : outRefs) {
-    const auto &refFile = dApp->project()->files().at(outRef.first);
-    _table->insertRow(i);
-    auto col0 = new QTableWidgetItem(inRefText);
-    col0->setData(Qt::UserRole, QVariant(i));
-    _table->setItem(i, 0, col0);
-    auto col1 = new QTableWidgetItem(
-        QString("%1@%2").arg(QString::fromStdString(refFile->getName()),
-                             displayTextForAddress(outRef.second)));
-    col1->setData(Qt::UserRole, QVariant(i));
-    _table->setItem(i, 1, col1);
-    i++;
-  }
-  std::copy(outRefs.begin(), outRefs.end(), std::back_inserter(_outAddresses));
-}
-
-void XrefDialog::addVarRefs(
-    int &i, const std::vector<std::pair<VariableRefType, int>> &varRefs) {
-  for (const auto &inRef : varRefs) {
-    QString inRefText;
-    if (inRef.first == VariableRefType ::GlobalVar) {
-      inRefText =
-          QString("GlobalVars[%1]")
-              .arg(dApp->project()->getVarName(inRef.first, inRef.second));
-    } else {
-      inRefText =
-          QString("Flags[%1]")
-              .arg(dApp->project()->getVarName(inRef.first, inRef.second));
-    }
-    addReferences(i, inRefText,
-                  dApp->project()->getVariableRefs(inRef.first, inRef.second));
-  }
-}
-
 int XrefDialog::exec() {
-  if (_table->rowCount() < 1) return QDialog::Rejected;
+  if (_model->rowCount() < 1) return QDialog::Rejected;
   return QDialog::exec();
 }
 
@@ -143,12 +97,7 @@ void XrefDialog::accept() {
 }
 
 void XrefDialog::goToItem() {
-  auto selectedItems = _table->selectedItems();
-  if (selectedItems.size() == 0) return;
-  auto tableItem = selectedItems.first();
-  if (tableItem == nullptr) return;
-  auto refId = tableItem->data(Qt::UserRole).toInt();
-  if (refId < 0 || refId > _outAddresses.size()) return;
-  dApp->project()->goToAddress(_outAddresses[refId].first,
-                               _outAddresses[refId].second);
+  auto ref = _model->refForIndex(_table->currentIndex());
+  if (ref.first < 0) return;
+  dApp->project()->goToAddress(ref.first, ref.second);
 }
\ No newline at end of file
@@ -2,9 +2,10 @@
 
 #include <QDialog>
 #include <QDialogButtonBox>
-#include <QTableWidget>
+#include <QTableView>
 #include <parser/SCXTypes.h>
 #include "enums.h"
+#include "xrefmodel.h"
 
 class XrefDialog : public QDialog {
   Q_OBJECT
@@ -13,6 +14,10 @@ class XrefDialog : public QDialog {
   explicit XrefDialog(int fileId, int labelIdOrAddress, bool isLabel,
                       QWidget *parent = 0);
   explicit XrefDialog(VariableRefType type, int var, QWidget *parent = 0);
+  enum class CallDirection { Callers, Callees };
+  // calls to or from the label, from the project's call graph
+  XrefDialog(CallDirection direction, int fileId, int labelId,
+             QWidget *parent = 0);
 
  public slots:
   int exec() override;
@@ -24,13 +29,8 @@ class XrefDialog : public QDialog {
  private:
   void setupViewBeforeData();
   void setupViewAfterData();
-  void addReferences(int &i, const QString &inRefText,
-                     const std::vector<std::pair<int, SCXOffset>> &outRefs);
-  void addVarRefs(int &i,
-                  const std::vector<std::pair<VariableRefType, int>> &varRefs);
 
-  QTableWidget *_table;
+  XrefModel *_model;
+  QTableView *_table;
   QDialogButtonBox *_buttons;
-
-  std::vector<std::pair<int, SCXOffset>> _outAddresses;
 };
@@ -0,0 +1,130 @@
+#include "xrefindex.h"
+#include <algorithm>
+#include <iterator>
+
+void XrefIndex::addVariableRef(VariableRefType type, int var, int fileId,
+                               SCXOffset address) {
+  _variableRefs.add(makeKey((int)type, var), {fileId, address});
+}
+
+void XrefIndex::addLabelRef(int fileId, int labelId, SCXOffset address) {
+  _labelRefs.add(makeKey(fileId, labelId), {fileId, address});
+}
+
+void XrefIndex::addFarLabelRef(int fileId, SCXOffset address, int targetFileId,
+                               int labelId) {
+  _labelRefs.add(makeKey(targetFileId, labelId), {fileId, address});
+}
+
+void XrefIndex::addScriptLoadRef(int fileId, SCXOffset address,
+                                 int targetFileId) {
+  _scriptLoadRefs.add(targetFileId, {fileId, address});
+}
+
+void XrefIndex::addStringRef(int fileId, int stringId, SCXOffset address) {
+  _stringRefs.add(makeKey(fileId, stringId), {fileId, address});
+}
+
+void XrefIndex::build() {
+  _variableRefs.build();
+  _labelRefs.build();
+  _scriptLoadRefs.build();
+  _stringRefs.build();
+}
+
+void XrefIndex::clear() {
+  _variableRefs.clear();
+  _labelRefs.clear();
+  _scriptLoadRefs.clear();
+  _stringRefs.clear();
+}
+
+std::vector<std::pair<int, SCXOffset>> XrefIndex::variableRefs(
+    VariableRefType type, int var) const {
+  return toVector(_variableRefs.find(makeKey((int)type, var)));
+}
+
+std::vector<std::pair<int, SCXOffset>> XrefIndex::labelRefs(
+    int fileId, int labelId) const {
+  return toVector(_labelRefs.find(makeKey(fileId, labelId)));
+}
+
+std::vector<std::pair<int, SCXOffset>> XrefIndex::scriptLoadRefs(
+    int fileId) const {
+  return toVector(_scriptLoadRefs.find((uint32_t)fileId));
+}
+
+std::vector<std::pair<int, SCXOffset>> XrefIndex::stringRefs(
+    int fileId, int stringId) const {
+  return toVector(_stringRefs.find(makeKey(fileId, stringId)));
+}
+
+std::vector<std::pair<int, SCXOffset>> XrefIndex::toVector(
+    std::pair<const Ref *, const Ref *> range) {
+  std::vector<std::pair<int, SCXOffset>> result;
+  result.reserve(range.second - range.first);
+  for (const Ref *ref = range.first; ref != range.second; ref++) {
+    result.emplace_back(ref->fileId, ref->address);
+  }
+  return result;
+}
+
+void XrefIndex::Table::add(uint64_t key, const Ref &ref) {
+  _pending.emplace_back(key, ref);
+}
+
+void XrefIndex::Table::build() {
+  if (_pending.empty()) return;
+
+  // merge with what's already built so build() can be called repeatedly
+  std::vector<std::pair<uint64_t, Ref>> all;
+  all.reserve(_refs.size() + _pending.size());
+  for (size_t i = 0; i < _keys.size(); i++) {
+    for (uint32_t j = _offsets[i]; j < _offsets[i + 1]; j++) {
+      all.emplace_back(_keys[i], _refs[j]);
+    }
+  }
+  std::move(_pending.begin(), _pending.end(), std::back_inserter(all));
+  _pending.clear();
+  _pending.shrink_to_fit();
+
+  std::sort(all.begin(), all.end(),
+            [](const std::pair<uint64_t, Ref> &a,
+               const std::pair<uint64_t, Ref> &b) {
+              if (a.first != b.first) return a.first < b.first;
+              if (a.second.fileId != b.second.fileId)
+                return a.second.fileId < b.second.fileId;
+              return a.second.address < b.second.address;
+            });
+
+  _keys.clear();
+  _offsets.clear();
+  _refs.clear();
+  _refs.reserve(all.size());
+  for (const auto &entry : all) {
+    if (_keys.empty() || _keys.back() != entry.first) {
+      _keys.push_back(entry.first);
+      _offsets.push_back((uint32_t)_refs.size());
+    }
+    _refs.push_back(entry.second);
+  }
+  _offsets.push_back((uint32_t)_refs.size());
+  _keys.shrink_to_fit();
+  _offsets.shrink_to_fit();
+}
+
+void XrefIndex::Table::clear() {
+  _keys.clear();
+  _offsets.clear();
+  _refs.clear();
+  _pending.clear();
+}
+
+std::pair<const XrefIndex::Ref *, const XrefIndex::Ref *>
+XrefIndex::Table::find(uint64_t key) const {
+  auto it = std::lower_bound(_keys.begin(), _keys.end(), key);
+  if (it == _keys.end() || *it != key) return std::make_pair(nullptr, nullptr);
+  size_t i = it - _keys.begin();
+  return std::make_pair(_refs.data() + _offsets[i],
+                        _refs.data() + _offsets[i + 1]);
+}
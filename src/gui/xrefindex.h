@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <parser/SCXTypes.h>
+#include "enums.h"
+
+// Compact in-memory cross-reference index, so xref lookups don't need to hit
+// the database. Each table is stored CSR-style: sorted unique keys, an offset
+// array into one flat array of (fileId, address) references.
+class XrefIndex {
+ public:
+  struct Ref {
+    int fileId;
+    SCXOffset address;
+  };
+
+  void addVariableRef(VariableRefType type, int var, int fileId,
+                      SCXOffset address);
+  void addLabelRef(int fileId, int labelId, SCXOffset address);
+  // ref to labelId in targetFileId from fileId
+  void addFarLabelRef(int fileId, SCXOffset address, int targetFileId,
+                      int labelId);
+  void addScriptLoadRef(int fileId, SCXOffset address, int targetFileId);
+  void addStringRef(int fileId, int stringId, SCXOffset address);
+  // call after adding refs, before querying
+  void build();
+  void clear();
+
+  std::vector<std::pair<int, SCXOffset>> variableRefs(VariableRefType type,
+                                                      int var) const;
+  // local and far refs
+  std::vector<std::pair<int, SCXOffset>> labelRefs(int fileId,
+                                                   int labelId) const;
+  std::vector<std::pair<int, SCXOffset>> scriptLoadRefs(int fileId) const;
+  std::vector<std::pair<int, SCXOffset>> stringRefs(int fileId,
+                                                    int stringId) const;
+
+ private:
+  class Table {
+   public:
+    void add(uint64_t key, const Ref& ref);
+    void build();
+    void clear();
+    std::pair<const Ref*, const Ref*> find(uint64_t key) const;
+
+   private:
+    std::vector<uint64_t> _keys;
+    std::vector<uint32_t> _offsets;
+    std::vector<Ref> _refs;
+    std::vector<std::pair<uint64_t, Ref>> _pending;
+  };
+
+  static uint64_t makeKey(int hi, int lo) {
+    return ((uint64_t)(uint32_t)hi << 32) | (uint32_t)lo;
+  }
+  static std::vector<std::pair<int, SCXOffset>> toVector(
+      std::pair<const Ref*, const Ref*> range);
+
+  Table _variableRefs;
+  Table _labelRefs;
+  Table _scriptLoadRefs;
+  Table _stringRefs;
+};
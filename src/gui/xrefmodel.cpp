@@ -0,0 +1,215 @@
+#include "xrefmodel.h"
+#include "analysis.h"
+#include "debuggerapplication.h"
+#include "project.h"
+#include "textdump.h"
+#include "viewhelper.h"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+XrefModel::XrefModel(QObject *parent) : QAbstractTableModel(parent) {}
+
+void XrefModel::addRefs(const Item &item,
+                        const std::vector<std::pair<int, SCXOffset>> &refs) {
+  if (refs.empty()) return;
+  beginInsertRows(QModelIndex(), _rows.size(), _rows.size() + refs.size() - 1);
+  int itemIndex = _items.size();
+  _items.push_back(item);
+  size_t first = _rows.size();
+  _rows.reserve(_rows.size() + refs.size());
+  for (const auto &ref : refs)
+    _rows.push_back({itemIndex, ref.first, ref.second, nullptr});
+  resolveInstructions(first);
+  endInsertRows();
+}
+
+// Refs can number in the thousands, so each file's addresses are looked up
+// in one batch rather than one by one
+void XrefModel::resolveInstructions(size_t first) {
+  Project *project = dApp->project();
+  std::map<int, std::vector<size_t>> rowsByFile;
+  for (size_t i = first; i < _rows.size(); i++)
+    rowsByFile[_rows[i].fileId].push_back(i);
+  for (const auto &fileRows : rowsByFile) {
+    auto file = project->files().find(fileRows.first);
+    if (file == project->files().end()) continue;
+    project->ensureDisassembled(fileRows.first);
+    const SCXFile *script = file->second.get();
+    std::vector<SCXOffset> addresses;
+    addresses.reserve(fileRows.second.size());
+    for (size_t row : fileRows.second) addresses.push_back(_rows[row].address);
+    auto ids = instIdsAtAddresses(script, addresses);
+    for (size_t i = 0; i < ids.size(); i++) {
+      int labelId = ids[i].first, instId = ids[i].second;
+      if (labelId < 0 || labelId >= (int)script->disassembly().size())
+        continue;
+      const auto &insts = script->disassembly()[labelId]->instructions();
+      if (instId < 0 || instId >= (int)insts.size()) continue;
+      // only the instruction starting there references anything
+      if (insts[instId]->position() != addresses[i]) continue;
+      _rows[fileRows.second[i]].inst = insts[instId].get();
+    }
+  }
+}
+
+void XrefModel::addVariableRefs(VariableRefType type, int var) {
+  Item item;
+  item.isLabel = false;
+  item.type = type;
+  item.fileId = -1;
+  item.id = var;
+  addRefs(item, dApp->project()->getVariableRefs(type, var));
+}
+
+void XrefModel::addLabelRefs(int fileId, int labelId) {
+  Item item;
+  item.isLabel = true;
+  item.type = VariableRefType::GlobalVar;
+  item.fileId = fileId;
+  item.id = labelId;
+  auto refs = dApp->project()->getLabelRefs(fileId, labelId);
+  // the file may not be disassembled yet, but its label table is always there
+  const SCXFile *file = dApp->project()->files().at(fileId).get();
+  refs.emplace_back(fileId, file->getLabelOffset(labelId));
+  addRefs(item, refs);
+}
+
+void XrefModel::addCallers(int fileId, int labelId) {
+  Item item;
+  item.isLabel = true;
+  item.type = VariableRefType::GlobalVar;
+  item.fileId = fileId;
+  item.id = labelId;
+  std::vector<std::pair<int, SCXOffset>> refs;
+  for (const auto &call : dApp->project()->getCallers(fileId, labelId))
+    refs.emplace_back(call.fileId, call.address);
+  addRefs(item, refs);
+}
+
+void XrefModel::addCallees(int fileId, int labelId) {
+  Item item;
+  item.isLabel = true;
+  item.type = VariableRefType::GlobalVar;
+  for (const auto &call : dApp->project()->getCallees(fileId, labelId)) {
+    item.fileId = call.fileId;
+    item.id = call.labelId;
+    addRefs(item, {std::make_pair(fileId, call.address)});
+  }
+}
+
+std::pair<int, SCXOffset> XrefModel::refForIndex(
+    const QModelIndex &index) const {
+  if (!index.isValid() || index.row() >= (int)_rows.size())
+    return std::make_pair(-1, -1);
+  const Row &row = _rows[index.row()];
+  return std::make_pair(row.fileId, row.address);
+}
+
+int XrefModel::columnCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  return (int)ColumnType::NumColumns;
+}
+
+int XrefModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  return _rows.size();
+}
+
+const QString &XrefModel::itemText(int item) const {
+  const Item &it = _items[item];
+  if (!it.text.isEmpty()) return it.text;
+  Project *project = dApp->project();
+  if (it.isLabel)
+    it.text = QString("#%1").arg(project->getLabelName(it.fileId, it.id));
+  else if (it.type == VariableRefType::GlobalVar)
+    it.text =
+        QString("GlobalVars[%1]").arg(project->getVarName(it.type, it.id));
+  else
+    it.text = QString("Flags[%1]").arg(project->getVarName(it.type, it.id));
+  return it.text;
+}
+
+QString XrefModel::fileName(int fileId) const {
+  return QString::fromStdString(
+      dApp->project()->files().at(fileId)->getName());
+}
+
+QVariant XrefModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || role != Qt::DisplayRole) return QVariant();
+  const Row &row = _rows[index.row()];
+  switch ((ColumnType)index.column()) {
+    case ColumnType::Item:
+      return itemText(row.item);
+    case ColumnType::ReferencedAt:
+      return QString("%1@%2").arg(fileName(row.fileId),
+                                  displayTextForAddress(row.address));
+    case ColumnType::Instruction:
+      if (row.inst == nullptr) return QVariant();
+      return QString::fromStdString(DumpSC3InstructionToText(
+          false, dApp->project()->contextProvider(), row.fileId, row.inst));
+    default:
+      return QVariant();
+  }
+}
+
+QVariant XrefModel::headerData(int section, Qt::Orientation orientation,
+                               int role) const {
+  if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+    return QVariant();
+  switch ((ColumnType)section) {
+    case ColumnType::Item:
+      return QVariant("Item");
+    case ColumnType::ReferencedAt:
+      return QVariant("Referenced at");
+    case ColumnType::Instruction:
+      return QVariant("Instruction");
+    default:
+      return QVariant();
+  }
+}
+
+void XrefModel::sort(int column, Qt::SortOrder order) {
+  // only a handful of distinct items and files, so compare their ranks
+  // instead of their text
+  std::vector<int> itemRanks(_items.size());
+  std::vector<int> byText(_items.size());
+  for (size_t i = 0; i < byText.size(); i++) byText[i] = i;
+  std::sort(byText.begin(), byText.end(),
+            [&](int a, int b) { return itemText(a) < itemText(b); });
+  for (size_t i = 0; i < byText.size(); i++) itemRanks[byText[i]] = i;
+
+  std::map<QString, int> filesByName;
+  for (const Row &row : _rows) filesByName[fileName(row.fileId)] = row.fileId;
+  std::unordered_map<int, int> fileRanks;
+  int rank = 0;
+  for (const auto &file : filesByName) fileRanks[file.second] = rank++;
+
+  auto less = [&](const Row &a, const Row &b) {
+    if ((ColumnType)column == ColumnType::Item && a.item != b.item)
+      return itemRanks[a.item] < itemRanks[b.item];
+    if (a.fileId != b.fileId) return fileRanks[a.fileId] < fileRanks[b.fileId];
+    return a.address < b.address;
+  };
+  std::vector<int> permutation(_rows.size());
+  for (size_t i = 0; i < permutation.size(); i++) permutation[i] = i;
+  std::stable_sort(permutation.begin(), permutation.end(), [&](int a, int b) {
+    return order == Qt::AscendingOrder ? less(_rows[a], _rows[b])
+                                       : less(_rows[b], _rows[a]);
+  });
+
+  emit layoutAboutToBeChanged();
+  std::vector<Row> sorted(_rows.size());
+  std::vector<int> newRow(_rows.size());
+  for (size_t i = 0; i < permutation.size(); i++) {
+    sorted[i] = _rows[permutation[i]];
+    newRow[permutation[i]] = i;
+  }
+  _rows.swap(sorted);
+  QModelIndexList from = persistentIndexList();
+  QModelIndexList to;
+  for (const QModelIndex &index : from)
+    to.append(createIndex(newRow[index.row()], index.column()));
+  changePersistentIndexList(from, to);
+  emit layoutChanged();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <QAbstractTableModel>
+#include <QString>
+#include <parser/SC3Instruction.h>
+#include <parser/SCXTypes.h>
+#include "enums.h"
+#include <utility>
+#include <vector>
+
+// Rows of (referenced item, referencing address) over the xref arrays. Only
+// the arrays are copied in; display text is looked up when a row is shown,
+// once per referenced item.
+class XrefModel : public QAbstractTableModel {
+  Q_OBJECT
+
+ public:
+  enum class ColumnType { Item, ReferencedAt, Instruction, NumColumns };
+
+  explicit XrefModel(QObject *parent = 0);
+
+  void addVariableRefs(VariableRefType type, int var);
+  // also lists the label itself
+  void addLabelRefs(int fileId, int labelId);
+  // call sites calling the label
+  void addCallers(int fileId, int labelId);
+  // labels called from the label, at their call sites
+  void addCallees(int fileId, int labelId);
+
+  // (fileId, address)
+  std::pair<int, SCXOffset> refForIndex(const QModelIndex &index) const;
+
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+ private:
+  struct Item {
+    bool isLabel;
+    VariableRefType type;
+    int fileId;
+    // var or labelId
+    int id;
+    mutable QString text;
+  };
+  struct Row {
+    int item;
+    int fileId;
+    SCXOffset address;
+    // the referencing instruction, nullptr if there's none at the address
+    const SC3Instruction *inst;
+  };
+  std::vector<Item> _items;
+  std::vector<Row> _rows;
+
+  void addRefs(const Item &item,
+               const std::vector<std::pair<int, SCXOffset>> &refs);
+  const QString &itemText(int item) const;
+  QString fileName(int fileId) const;
+  // fills in Row::inst for rows [first, end)
+  void resolveInstructions(size_t first);
+};
@@ -0,0 +1,236 @@
+#include "MPKArchive.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <zlib.h>
+#include "ParallelFor.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static inline uint16_t readUint16Le(const uint8_t *src) {
+  return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static inline uint32_t readUint32Le(const uint8_t *src) {
+  return (uint32_t)src[0] | ((uint32_t)src[1] << 8) |
+         ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static inline uint64_t readUint64Le(const uint8_t *src) {
+  return (uint64_t)readUint32Le(src) | ((uint64_t)readUint32Le(src + 4) << 32);
+}
+
+MPKArchive::MPKArchive(const std::string &path) : _path(path) {
+  map(path);
+  try {
+    parseHeader();
+  } catch (...) {
+    unmap();
+    throw;
+  }
+}
+
+MPKArchive::~MPKArchive() { unmap(); }
+
+int MPKArchive::findEntry(const std::string &name) const {
+  for (size_t i = 0; i < _entries.size(); i++) {
+    if (_entries[i].name == name) return (int)i;
+  }
+  return -1;
+}
+
+uint8_t *MPKArchive::extractEntry(size_t index) const {
+  const MPKEntry &entry = _entries[index];
+  if (entry.compression != MPKUncompressed) return decompressEntry(index);
+  uint8_t *result = (uint8_t *)malloc(entry.size);
+  if (result == nullptr) return nullptr;
+  memcpy(result, entryData(index), entry.size);
+  return result;
+}
+
+std::vector<uint8_t *> MPKArchive::extractEntries(
+    const std::vector<size_t> &indices, int threadCount) const {
+  std::vector<uint8_t *> result(indices.size(), nullptr);
+  ParallelFor(indices.size(), threadCount,
+              [&](size_t i) { result[i] = extractEntry(indices[i]); });
+  return result;
+}
+
+uint8_t *MPKArchive::decompressEntry(size_t index) const {
+  const MPKEntry &entry = _entries[index];
+  if (entry.compression != MPKZlib) return nullptr;
+  if (entry.uncompressedSize == 0) return nullptr;
+
+  std::string cachePath = cachePathForEntry(index);
+  if (!cachePath.empty()) {
+    std::ifstream cached(cachePath, std::ios::binary | std::ios::ate);
+    if (cached && (uint64_t)cached.tellg() == entry.uncompressedSize) {
+      uint8_t *result = (uint8_t *)malloc(entry.uncompressedSize);
+      if (result == nullptr) return nullptr;
+      cached.seekg(0, std::ios::beg);
+      if (cached.read((char *)result, entry.uncompressedSize)) return result;
+      free(result);
+    }
+  }
+
+  uint8_t *result = (uint8_t *)malloc(entry.uncompressedSize);
+  if (result == nullptr) return nullptr;
+  uLongf destLength = (uLongf)entry.uncompressedSize;
+  if (uncompress(result, &destLength, entryData(index), (uLong)entry.size) !=
+          Z_OK ||
+      destLength != entry.uncompressedSize) {
+    free(result);
+    return nullptr;
+  }
+
+  if (!cachePath.empty()) {
+    // write under a unique name first so a concurrent reader never sees a
+    // partial file
+    std::string tmpPath = cachePath + "." + std::to_string(index) + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (out.write((const char *)result, entry.uncompressedSize)) {
+      out.close();
+      if (std::rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+        std::remove(tmpPath.c_str());
+    } else {
+      out.close();
+      std::remove(tmpPath.c_str());
+    }
+  }
+  return result;
+}
+
+std::string MPKArchive::cachePathForEntry(size_t index) const {
+  if (_cacheDirectory.empty()) return "";
+  const MPKEntry &entry = _entries[index];
+  // identifies the entry without reading its contents, which would cost a
+  // full pass over them on every cache hit
+  std::stringstream key;
+  key << _path << '\n'
+      << _length << '\n'
+      << _modificationTime << '\n'
+      << entry.id << '\n'
+      << entry.offset << '\n'
+      << entry.size << '\n'
+      << entry.uncompressedSize;
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : key.str()) {
+    hash ^= (uint8_t)c;
+    hash *= 0x100000001b3ULL;
+  }
+  std::stringstream name;
+  name << std::hex << std::setfill('0') << std::setw(16) << hash << "_"
+       << entry.uncompressedSize << ".bin";
+  return _cacheDirectory + "/" + name.str();
+}
+
+#ifdef _WIN32
+void MPKArchive::map(const std::string &path) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("Couldn't open " + path);
+  LARGE_INTEGER size;
+  FILETIME lastWrite;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 ||
+      !GetFileTime(file, NULL, NULL, &lastWrite)) {
+    CloseHandle(file);
+    throw std::runtime_error("Couldn't read " + path);
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL) {
+    CloseHandle(file);
+    throw std::runtime_error("Couldn't map " + path);
+  }
+  void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == NULL) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error("Couldn't map " + path);
+  }
+  _fileHandle = file;
+  _mappingHandle = mapping;
+  _data = (const uint8_t *)view;
+  _length = (uint64_t)size.QuadPart;
+  _modificationTime = ((uint64_t)lastWrite.dwHighDateTime << 32) |
+                      lastWrite.dwLowDateTime;
+}
+
+void MPKArchive::unmap() {
+  if (_data != nullptr) UnmapViewOfFile(_data);
+  if (_mappingHandle != nullptr) CloseHandle(_mappingHandle);
+  if (_fileHandle != nullptr) CloseHandle(_fileHandle);
+  _data = nullptr;
+  _mappingHandle = nullptr;
+  _fileHandle = nullptr;
+}
+#else
+void MPKArchive::map(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("Couldn't open " + path);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    throw std::runtime_error("Couldn't read " + path);
+  }
+  void *view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (view == MAP_FAILED) {
+    close(fd);
+    throw std::runtime_error("Couldn't map " + path);
+  }
+  _fd = fd;
+  _data = (const uint8_t *)view;
+  _length = (uint64_t)st.st_size;
+  _modificationTime = (uint64_t)st.st_mtime;
+}
+
+void MPKArchive::unmap() {
+  if (_data != nullptr) munmap((void *)_data, _length);
+  if (_fd >= 0) close(_fd);
+  _data = nullptr;
+  _fd = -1;
+}
+#endif
+
+void MPKArchive::parseHeader() {
+  if (_length < MPKHeaderSize || memcmp(_data, "MPK\0", 4) != 0)
+    throw std::runtime_error("Not an MPK archive");
+  uint16_t versionMinor = readUint16Le(_data + 4);
+  uint16_t versionMajor = readUint16Le(_data + 6);
+  if (versionMinor != 0 || versionMajor != 2)
+    throw std::runtime_error("Unsupported MPK version");
+  uint32_t entryCount = readUint32Le(_data + 8);
+  if (MPKHeaderSize + entryCount * MPKEntrySize > _length)
+    throw std::runtime_error("Truncated MPK entry table");
+
+  _entries.reserve(entryCount);
+  for (uint32_t i = 0; i < entryCount; i++) {
+    const uint8_t *raw = _data + MPKHeaderSize + MPKEntrySize * i;
+    MPKEntry entry;
+    entry.compression = readUint32Le(raw);
+    entry.id = (int)readUint32Le(raw + 4);
+    entry.offset = readUint64Le(raw + 8);
+    entry.size = readUint64Le(raw + 0x10);
+    entry.uncompressedSize = readUint64Le(raw + 0x18);
+    if (entry.compression == MPKUncompressed)
+      entry.uncompressedSize = entry.size;
+    const char *name = (const char *)raw + MPKEntryNameOffset;
+    entry.name = std::string(name, strnlen(name, MPKEntryNameSize));
+    if (entry.offset > _length || entry.size > _length - entry.offset)
+      throw std::runtime_error("MPK entry out of bounds: " + entry.name);
+    _entries.push_back(std::move(entry));
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum MPKCompression { MPKUncompressed = 0, MPKZlib = 1 };
+
+struct MPKEntry {
+  uint32_t compression;
+  int id;
+  uint64_t offset;
+  // size as stored in the archive
+  uint64_t size;
+  uint64_t uncompressedSize;
+  std::string name;
+};
+
+// Read-only view of an MPK archive. The archive is memory-mapped and only the
+// entry table is parsed up front, so entry contents are only paged in when
+// they're actually accessed.
+class MPKArchive {
+ public:
+  // throws std::runtime_error if the archive can't be mapped or isn't MPK 2.0
+  explicit MPKArchive(const std::string& path);
+  ~MPKArchive();
+  MPKArchive(const MPKArchive&) = delete;
+  MPKArchive& operator=(const MPKArchive&) = delete;
+
+  const std::vector<MPKEntry>& entries() const { return _entries; }
+  // index into entries(), -1 if not found
+  int findEntry(const std::string& name) const;
+
+  // points into the mapping, valid for the lifetime of the archive
+  const uint8_t* entryData(size_t index) const {
+    return _data + _entries[index].offset;
+  }
+  // malloc'd copy of an entry (uncompressedSize bytes), to be owned by an
+  // SCXFile. nullptr on unsupported compression or corrupt data.
+  uint8_t* extractEntry(size_t index) const;
+  // same as extractEntry, spread over threadCount threads (0 = one per core)
+  std::vector<uint8_t*> extractEntries(const std::vector<size_t>& indices,
+                                       int threadCount = 0) const;
+
+  // Decompressed entries are cached in this directory, so they only get
+  // inflated once. They're named by a hash of the archive's path, size and
+  // modification time and the entry's id, offset and sizes.
+  void setCacheDirectory(const std::string& path) { _cacheDirectory = path; }
+
+ private:
+  std::string _path;
+  const uint8_t* _data = nullptr;
+  uint64_t _length = 0;
+  // as the platform reports it, only compared for equality
+  uint64_t _modificationTime = 0;
+#ifdef _WIN32
+  void* _fileHandle = nullptr;
+  void* _mappingHandle = nullptr;
+#else
+  int _fd = -1;
+#endif
+  std::vector<MPKEntry> _entries;
+  std::string _cacheDirectory;
+
+  uint8_t* decompressEntry(size_t index) const;
+  std::string cachePathForEntry(size_t index) const;
+  void map(const std::string& path);
+  void unmap();
+  void parseHeader();
+
+  static const uint64_t MPKHeaderSize = 0x40;
+  static const uint64_t MPKEntrySize = 0x100;
+  static const uint64_t MPKEntryNameOffset = 0x20;
+  static const uint64_t MPKEntryNameSize = 0xE0;
+};
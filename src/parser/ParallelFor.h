@@ -0,0 +1,24 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Runs work(i) for every i < count, spread over up to threadCount threads
+// (0 = one per core). The calling thread is one of them, and indices are
+// handed out one at a time, so uneven work items balance out.
+inline void ParallelFor(size_t count, int threadCount,
+                        const std::function<void(size_t)>& work) {
+  if (threadCount <= 0) threadCount = std::thread::hardware_concurrency();
+  if (threadCount <= 0) threadCount = 1;
+  if (threadCount > (int)count) threadCount = (int)count;
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < count; i = next++) work(i);
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < threadCount; i++) threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads) thread.join();
+}
@@ -1,9 +1,17 @@
 #include "SC3BaseDisassembler.h"
+#include "SC3DecodeStats.h"
+#ifdef SC3_DECODE_STATS
+#include <chrono>
+#endif
 
 void SC3BaseDisassembler::DisassembleFile() {
   if (_file.getLabelCount() < 1) return;
   SCXOffset pos = _file.getLabelOffset(0);
 
+#ifdef SC3_DECODE_STATS
+  SC3DecodeStats stats;
+#endif
+
   for (SCXTableIndex i = 0; i < _file.getLabelCount(); i++) {
     SC3CodeBlock* label = new SC3CodeBlock(i, _file.getLabelOffset(i));
     SCXOffset end;
@@ -13,11 +21,25 @@ void SC3BaseDisassembler::DisassembleFile() {
       end = _file.getLabelOffset(i + 1);
 
     while (pos < end) {
+#ifdef SC3_DECODE_STATS
+      auto start = std::chrono::steady_clock::now();
+#endif
       SC3Instruction* inst = DisassembleAt(pos, end - pos);
+#ifdef SC3_DECODE_STATS
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      stats.recordInstruction(
+          _file.getPData() + pos, inst,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+              .count());
+#endif
       label->Append(inst);
       pos += inst->length();
     }
 
     _file.appendLabel(label);
   }
+
+#ifdef SC3_DECODE_STATS
+  SC3DecodeStats::mergeIntoGlobal(stats);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "SC3ControlFlow.h"
+#include <algorithm>
+#include <cstring>
+#include "ParallelFor.h"
+#include "SC3CodeBlock.h"
+#include "SCXFile.h"
+
+// control never comes back from these, or not to the next instruction
+static bool isExit(const std::string& name) {
+  return name == "EndOfScript" || name == "Return" || name == "End" ||
+         name == "Halt" || name == "Terminate" || name == "ExitThread" ||
+         name == "Reset" || name == "JumpFar";
+}
+
+// leave the script and may come back, or conditionally return
+static bool isFarTransfer(const std::string& name) {
+  return name == "CallFar" || name == "CallFarIfFlag" || name == "ReturnIfFlag";
+}
+
+namespace {
+struct Transfer {
+  uint32_t inst;
+  int labelId;
+  SC3ControlFlowGraph::EdgeKind kind;
+};
+}  // namespace
+
+// Jump tables are uint16 label ids from the table label's address up to the
+// next label, cut short at the first id that isn't one.
+static std::vector<int> jumpTableTargets(const SCXFile* file, int tableId) {
+  std::vector<int> result;
+  if (tableId >= file->getLabelCount()) return result;
+  SCXOffset start = file->getLabelOffset(tableId);
+  SCXOffset end = tableId + 1 < file->getLabelCount()
+                      ? file->getLabelOffset(tableId + 1)
+                      : file->getCodeEndOffset();
+  if (end < start || end > file->getLength()) return result;
+  for (SCXOffset pos = start; pos + 2 <= end; pos += 2) {
+    uint16_t labelId;
+    memcpy(&labelId, file->getPData() + pos, sizeof(labelId));
+    if (labelId >= file->getLabelCount()) break;
+    result.push_back(labelId);
+  }
+  return result;
+}
+
+int SC3ControlFlowGraph::blockForInstruction(uint32_t flatInstId) const {
+  if (flatInstId >= _blockStarts.back()) return blockCount();
+  return std::upper_bound(_blockStarts.begin(), _blockStarts.end(),
+                          flatInstId) -
+         _blockStarts.begin() - 1;
+}
+
+std::vector<bool> SC3ControlFlowGraph::reachableFrom(
+    const std::vector<int>& roots) const {
+  std::vector<bool> reached(blockCount(), false);
+  std::vector<int> pending;
+  for (int root : roots) {
+    if (root < 0 || root >= blockCount() || reached[root]) continue;
+    reached[root] = true;
+    pending.push_back(root);
+  }
+  while (!pending.empty()) {
+    int block = pending.back();
+    pending.pop_back();
+    auto edges = successors(block);
+    for (const Edge* edge = edges.first; edge != edges.second; edge++) {
+      if (reached[edge->block]) continue;
+      reached[edge->block] = true;
+      pending.push_back(edge->block);
+    }
+  }
+  return reached;
+}
+
+SC3ControlFlowGraph BuildSC3ControlFlowGraph(const SCXFile* file) {
+  typedef SC3ControlFlowGraph::Edge Edge;
+  SC3ControlFlowGraph result;
+  result._fileId = file->getId();
+  const std::vector<uint32_t>& labelStarts = file->labelInstructionStarts();
+  uint32_t instCount = labelStarts.back();
+  int labelCount = (int)labelStarts.size() - 1;
+
+  // where each block-ending instruction goes, in instruction order
+  std::vector<Transfer> transfers;
+  // ends its block, and whether the next instruction can follow it
+  std::vector<bool> endsBlock(instCount, false);
+  std::vector<bool> fallsThrough(instCount, true);
+  std::vector<bool> leader(instCount + 1, false);
+
+  uint32_t flat = 0;
+  for (const auto& label : file->disassembly()) {
+    leader[flat] = true;
+    for (const auto& inst : label->instructions()) {
+      const std::string& name = inst->name();
+      if (name == "JumpTable") {
+        endsBlock[flat] = true;
+        fallsThrough[flat] = false;
+        for (const auto& arg : inst->args()) {
+          if (arg.type != SC3ArgumentType::LocalLabel || arg.name != "jumpTable") continue;
+          for (int target : jumpTableTargets(file, arg.uint16_value))
+            transfers.push_back({flat, target, SC3ControlFlowGraph::Table});
+        }
+      } else if (isExit(name)) {
+        endsBlock[flat] = true;
+        fallsThrough[flat] = false;
+      } else if (isFarTransfer(name)) {
+        endsBlock[flat] = true;
+      } else {
+        for (const auto& arg : inst->args()) {
+          if (arg.type != SC3ArgumentType::LocalLabel || arg.name != "target") continue;
+          SC3ControlFlowGraph::EdgeKind kind = SC3ControlFlowGraph::Branch;
+          if (name == "Jump") {
+            kind = SC3ControlFlowGraph::Jump;
+            fallsThrough[flat] = false;
+          } else if (name.compare(0, 4, "Call") == 0) {
+            kind = SC3ControlFlowGraph::Call;
+          }
+          endsBlock[flat] = true;
+          transfers.push_back({flat, arg.uint16_value, kind});
+        }
+      }
+      if (endsBlock[flat]) leader[flat + 1] = true;
+      flat++;
+    }
+  }
+  for (const Transfer& transfer : transfers) {
+    if (transfer.labelId < labelCount)
+      leader[labelStarts[transfer.labelId]] = true;
+  }
+
+  for (uint32_t i = 0; i < instCount; i++) {
+    if (leader[i]) result._blockStarts.push_back(i);
+  }
+  result._blockStarts.push_back(instCount);
+  int blockCount = result.blockCount();
+
+  result._labelFirstBlock.reserve(labelCount + 1);
+  for (uint32_t start : labelStarts)
+    result._labelFirstBlock.push_back(result.blockForInstruction(start));
+
+  auto nextTransfer = transfers.begin();
+  result._successorStarts.reserve(blockCount + 1);
+  for (int block = 0; block < blockCount; block++) {
+    result._successorStarts.push_back((uint32_t)result._successors.size());
+    uint32_t last = result._blockStarts[block + 1] - 1;
+    while (nextTransfer != transfers.end() && nextTransfer->inst < last)
+      nextTransfer++;
+    for (; nextTransfer != transfers.end() && nextTransfer->inst == last;
+         nextTransfer++) {
+      if (nextTransfer->labelId >= labelCount) continue;
+      int target = result._labelFirstBlock[nextTransfer->labelId];
+      if (target < blockCount)
+        result._successors.push_back({(uint32_t)target, nextTransfer->kind});
+    }
+    if (fallsThrough[last] && block + 1 < blockCount)
+      result._successors.push_back(
+          {(uint32_t)block + 1, SC3ControlFlowGraph::FallThrough});
+
+    // jump tables often repeat targets
+    auto first =
+        result._successors.begin() + result._successorStarts.back();
+    std::sort(first, result._successors.end(),
+              [](const Edge& a, const Edge& b) {
+                return a.block != b.block ? a.block < b.block
+                                          : a.kind < b.kind;
+              });
+    result._successors.erase(
+        std::unique(first, result._successors.end(),
+                    [](const Edge& a, const Edge& b) {
+                      return a.block == b.block && a.kind == b.kind;
+                    }),
+        result._successors.end());
+  }
+  result._successorStarts.push_back((uint32_t)result._successors.size());
+
+  // predecessors by counting sort over the targets
+  result._predecessorStarts.assign(blockCount + 1, 0);
+  for (const Edge& edge : result._successors)
+    result._predecessorStarts[edge.block + 1]++;
+  for (int block = 0; block < blockCount; block++)
+    result._predecessorStarts[block + 1] += result._predecessorStarts[block];
+  result._predecessors.resize(result._successors.size());
+  std::vector<uint32_t> fill(result._predecessorStarts.begin(),
+                             result._predecessorStarts.end() - 1);
+  for (int block = 0; block < blockCount; block++) {
+    auto edges = result.successors(block);
+    for (const Edge* edge = edges.first; edge != edges.second; edge++)
+      result._predecessors[fill[edge->block]++] = {(uint32_t)block,
+                                                   edge->kind};
+  }
+  return result;
+}
+
+std::vector<SC3ControlFlowGraph> BuildSC3ControlFlowGraphs(
+    const std::vector<const SCXFile*>& files, int threadCount) {
+  std::vector<SC3ControlFlowGraph> result(files.size());
+  ParallelFor(files.size(), threadCount, [&](size_t i) {
+    result[i] = BuildSC3ControlFlowGraph(files[i]);
+  });
+  return result;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "SCXTypes.h"
+
+class SCXFile;
+
+// Basic blocks of one disassembled script and the local edges between them.
+// Instructions are numbered flat as in SCXFile::instructionOffsets(). Blocks
+// are numbered in address order and stored as their first instruction; edges
+// are CSR arrays in both directions.
+//
+// A block ends at a label, before an instruction that is a branch target, and
+// after every instruction that transfers control: anything with a local
+// "target" argument, JumpTable, far jumps and calls, returns and ends. Calls
+// get a Call edge and fall through to the return site. Far jumps and calls
+// have no edges here; CallGraph has those.
+class SC3ControlFlowGraph {
+ public:
+  enum EdgeKind : uint8_t {
+    FallThrough,
+    // unconditional Jump
+    Jump,
+    // taken side of a conditional jump (If, Loop, FlagOnJump...)
+    Branch,
+    Call,
+    // one of a JumpTable's targets
+    Table
+  };
+  struct Edge {
+    uint32_t block;
+    EdgeKind kind;
+  };
+
+  int fileId() const { return _fileId; }
+  int blockCount() const { return (int)_blockStarts.size() - 1; }
+  // [first, end) flat instruction indices
+  std::pair<uint32_t, uint32_t> instructionsOfBlock(int block) const {
+    return std::make_pair(_blockStarts[block], _blockStarts[block + 1]);
+  }
+  int blockForInstruction(uint32_t flatInstId) const;
+  // the block at the label's address, which is the next label's for empty
+  // labels. blockCount() if nothing follows
+  int blockForLabel(int labelId) const { return _labelFirstBlock[labelId]; }
+
+  std::pair<const Edge*, const Edge*> successors(int block) const {
+    return std::make_pair(_successors.data() + _successorStarts[block],
+                          _successors.data() + _successorStarts[block + 1]);
+  }
+  std::pair<const Edge*, const Edge*> predecessors(int block) const {
+    return std::make_pair(_predecessors.data() + _predecessorStarts[block],
+                          _predecessors.data() + _predecessorStarts[block + 1]);
+  }
+
+  // blocks reachable from the roots over any edge
+  std::vector<bool> reachableFrom(const std::vector<int>& roots) const;
+
+ private:
+  friend SC3ControlFlowGraph BuildSC3ControlFlowGraph(const SCXFile* file);
+
+  int _fileId = -1;
+  // plus the total instruction count at the end
+  std::vector<uint32_t> _blockStarts;
+  // per label, plus blockCount() at the end
+  std::vector<uint32_t> _labelFirstBlock;
+  std::vector<uint32_t> _successorStarts;
+  std::vector<Edge> _successors;
+  // Edge::block is the source here
+  std::vector<uint32_t> _predecessorStarts;
+  std::vector<Edge> _predecessors;
+};
+
+// file must be disassembled
+SC3ControlFlowGraph BuildSC3ControlFlowGraph(const SCXFile* file);
+// in the same order, threadCount 0 = one per core
+std::vector<SC3ControlFlowGraph> BuildSC3ControlFlowGraphs(
+    const std::vector<const SCXFile*>& files, int threadCount = 0);
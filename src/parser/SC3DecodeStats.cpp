@@ -0,0 +1,167 @@
+#include "SC3DecodeStats.h"
+
+#ifdef SC3_DECODE_STATS
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include "SC3Instruction.h"
+
+static std::mutex GlobalStatsMutex;
+static SC3DecodeStats GlobalStats;
+
+static int expressionDepth(const SC3ExpressionNode *node) {
+  if (node == nullptr) return 0;
+  return 1 + std::max(expressionDepth(node->lhs.get()),
+                      expressionDepth(node->rhs.get()));
+}
+
+static bool argHasExpression(const SC3Argument &arg) {
+  return arg.type == SC3ArgumentType::Expression ||
+         arg.type == SC3ArgumentType::FarLabel ||
+         arg.type == SC3ArgumentType::ExprFlagRef ||
+         arg.type == SC3ArgumentType::ExprGlobalVarRef ||
+         arg.type == SC3ArgumentType::ExprThreadVarRef;
+}
+
+SC3DecodeStats::SC3DecodeStats() : _entryCounts(256 * 256) { reset(); }
+
+void SC3DecodeStats::reset() {
+  std::fill(_entryCounts.begin(), _entryCounts.end(), 0);
+  _entryNames.clear();
+  memset(_tableCounts, 0, sizeof(_tableCounts));
+  memset(_tableNanoseconds, 0, sizeof(_tableNanoseconds));
+  memset(_exprDepthHistogram, 0, sizeof(_exprDepthHistogram));
+  memset(_argCountHistogram, 0, sizeof(_argCountHistogram));
+  _instructionCount = 0;
+  _totalBytes = 0;
+  _unrecognizedCount = 0;
+  _unrecognizedBytes = 0;
+}
+
+void SC3DecodeStats::recordInstruction(const uint8_t *data,
+                                       const SC3Instruction *inst,
+                                       int64_t nanoseconds) {
+  uint8_t table = data[0];
+  // Assign has a single-byte opcode, and a truncated instruction at the end
+  // of the file may not have a second byte, so those count under the table
+  uint8_t entry = table == 0xFE || inst->length() < 2 ? 0 : data[1];
+  uint16_t key = (uint16_t)((table << 8) | entry);
+
+  _instructionCount++;
+  _totalBytes += inst->length();
+  _tableCounts[table]++;
+  _tableNanoseconds[table] += nanoseconds;
+
+  if (inst->name() == "__Unrecognized__") {
+    _unrecognizedCount++;
+    _unrecognizedBytes += inst->length();
+    return;
+  }
+
+  if (_entryCounts[key]++ == 0) _entryNames.emplace(key, inst->name());
+
+  _argCountHistogram[std::min((int)inst->args().size(), (int)MaxArgCount)]++;
+  for (const auto &arg : inst->args()) {
+    if (!argHasExpression(arg)) continue;
+    int depth = expressionDepth(arg.exprValue.root());
+    _exprDepthHistogram[std::min(depth, (int)MaxExpressionDepth)]++;
+  }
+}
+
+void SC3DecodeStats::merge(const SC3DecodeStats &other) {
+  for (size_t i = 0; i < _entryCounts.size(); i++) {
+    _entryCounts[i] += other._entryCounts[i];
+  }
+  _entryNames.insert(other._entryNames.begin(), other._entryNames.end());
+  for (int i = 0; i < 256; i++) {
+    _tableCounts[i] += other._tableCounts[i];
+    _tableNanoseconds[i] += other._tableNanoseconds[i];
+  }
+  for (int i = 0; i <= MaxExpressionDepth; i++) {
+    _exprDepthHistogram[i] += other._exprDepthHistogram[i];
+  }
+  for (int i = 0; i <= MaxArgCount; i++) {
+    _argCountHistogram[i] += other._argCountHistogram[i];
+  }
+  _instructionCount += other._instructionCount;
+  _totalBytes += other._totalBytes;
+  _unrecognizedCount += other._unrecognizedCount;
+  _unrecognizedBytes += other._unrecognizedBytes;
+}
+
+std::string SC3DecodeStats::report() const {
+  std::stringstream out;
+  out << "Instructions decoded: " << _instructionCount << "\n";
+  out << "Bytes decoded: " << _totalBytes << "\n";
+  out << "__Unrecognized__: " << _unrecognizedCount << " instructions, "
+      << _unrecognizedBytes << " bytes";
+  if (_totalBytes > 0) {
+    out << " (" << std::fixed << std::setprecision(2)
+        << 100.0 * _unrecognizedBytes / _totalBytes << "%)";
+  }
+  out << "\n";
+
+  out << "\nPer opcode table:\n";
+  out << "  table      count     total us   avg ns\n";
+  for (int i = 0; i < 256; i++) {
+    if (_tableCounts[i] == 0) continue;
+    out << "  " << std::hex << std::setw(2) << std::setfill('0') << i
+        << std::dec << std::setfill(' ') << "    " << std::setw(10)
+        << _tableCounts[i] << "   " << std::setw(10)
+        << _tableNanoseconds[i] / 1000 << "   " << std::setw(6)
+        << _tableNanoseconds[i] / (int64_t)_tableCounts[i] << "\n";
+  }
+
+  std::vector<std::pair<uint64_t, uint16_t>> entries;
+  for (size_t i = 0; i < _entryCounts.size(); i++) {
+    if (_entryCounts[i] > 0) entries.emplace_back(_entryCounts[i], (uint16_t)i);
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const std::pair<uint64_t, uint16_t> &a,
+               const std::pair<uint64_t, uint16_t> &b) {
+              return a.first > b.first;
+            });
+  out << "\nPer opcode:\n";
+  for (const auto &entry : entries) {
+    out << "  " << std::hex << std::setfill('0') << std::setw(2)
+        << (entry.second >> 8) << " " << std::setw(2) << (entry.second & 0xFF)
+        << std::dec << std::setfill(' ') << "  " << std::setw(10)
+        << entry.first << "  " << _entryNames.at(entry.second) << "\n";
+  }
+
+  out << "\nArgument count histogram:\n";
+  for (int i = 0; i <= MaxArgCount; i++) {
+    if (_argCountHistogram[i] == 0) continue;
+    out << "  " << std::setw(2) << i << (i == MaxArgCount ? "+" : " ")
+        << std::setw(10) << _argCountHistogram[i] << "\n";
+  }
+
+  out << "\nExpression depth histogram:\n";
+  for (int i = 0; i <= MaxExpressionDepth; i++) {
+    if (_exprDepthHistogram[i] == 0) continue;
+    out << "  " << std::setw(2) << i << (i == MaxExpressionDepth ? "+" : " ")
+        << std::setw(10) << _exprDepthHistogram[i] << "\n";
+  }
+
+  return out.str();
+}
+
+void SC3DecodeStats::mergeIntoGlobal(const SC3DecodeStats &local) {
+  std::lock_guard<std::mutex> lock(GlobalStatsMutex);
+  GlobalStats.merge(local);
+}
+
+void SC3DecodeStats::resetGlobal() {
+  std::lock_guard<std::mutex> lock(GlobalStatsMutex);
+  GlobalStats.reset();
+}
+
+std::string SC3DecodeStats::globalReport() {
+  std::lock_guard<std::mutex> lock(GlobalStatsMutex);
+  return GlobalStats.report();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "SCXTypes.h"
+
+// Opt-in decoder instrumentation. Only compiled in when SC3_DECODE_STATS is
+// defined (qmake CONFIG+=decode_stats), so the disassembly hot path pays
+// nothing for it otherwise.
+#ifdef SC3_DECODE_STATS
+
+class SC3Instruction;
+
+class SC3DecodeStats {
+ public:
+  static const int MaxExpressionDepth = 32;
+  static const int MaxArgCount = 16;
+
+  SC3DecodeStats();
+
+  // data points at the raw instruction that was handed to DisassembleAt
+  void recordInstruction(const uint8_t* data, const SC3Instruction* inst,
+                         int64_t nanoseconds);
+  void merge(const SC3DecodeStats& other);
+  void reset();
+
+  std::string report() const;
+
+  // process-wide totals, fed by SC3BaseDisassembler::DisassembleFile
+  static void mergeIntoGlobal(const SC3DecodeStats& local);
+  static void resetGlobal();
+  static std::string globalReport();
+
+ private:
+  // indexed by (table << 8) | entry, table being the opcode MSB
+  std::vector<uint64_t> _entryCounts;
+  std::map<uint16_t, std::string> _entryNames;
+  uint64_t _tableCounts[256];
+  int64_t _tableNanoseconds[256];
+  uint64_t _exprDepthHistogram[MaxExpressionDepth + 1];
+  uint64_t _argCountHistogram[MaxArgCount + 1];
+  uint64_t _instructionCount;
+  uint64_t _totalBytes;
+  uint64_t _unrecognizedCount;
+  uint64_t _unrecognizedBytes;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "SC3InstructionSearch.h"
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "ParallelFor.h"
+#include "SC3CodeBlock.h"
+#include "SCXFile.h"
+
+static const std::unordered_map<std::string, SC3ArgumentType> ArgTypeNames = {
+    {"ByteArray", ByteArray},         {"Byte", Byte},
+    {"UInt16", UInt16},               {"Expression", Expression},
+    {"LocalLabel", LocalLabel},       {"FarLabel", FarLabel},
+    {"ReturnAddress", ReturnAddress}, {"StringRef", StringRef},
+    {"FlagRef", ExprFlagRef},         {"GlobalVarRef", ExprGlobalVarRef},
+    {"ThreadVarRef", ExprThreadVarRef}};
+
+static int parseNumber(const std::string& text) {
+  try {
+    size_t end;
+    int result = std::stoi(text, &end, 0);
+    if (end == text.size()) return result;
+  } catch (const std::logic_error&) {
+  }
+  throw std::runtime_error("Not a number: " + text);
+}
+
+static SC3VarPattern parseVar(const std::string& text) {
+  SC3VarPattern result;
+  std::string index;
+  if (text.compare(0, 11, "GlobalVars[") == 0) {
+    result.space = FuncGlobalVars;
+    index = text.substr(11);
+  } else if (text.compare(0, 6, "Flags[") == 0) {
+    result.space = FuncFlags;
+    index = text.substr(6);
+  } else {
+    throw std::runtime_error("Expected GlobalVars[N] or Flags[N]: " + text);
+  }
+  if (index.empty() || index.back() != ']')
+    throw std::runtime_error("Missing ]: " + text);
+  index.pop_back();
+  result.index = index == "*" ? -1 : parseNumber(index);
+  return result;
+}
+
+SC3InstructionQuery SC3InstructionQuery::parse(const std::string& text) {
+  SC3InstructionQuery query;
+  std::istringstream tokens(text);
+  std::string token;
+  if (!(tokens >> token)) throw std::runtime_error("Empty query");
+  if (token != "*") query._opcode = token;
+
+  while (tokens >> token) {
+    SC3SearchPredicate predicate;
+    if (token.compare(0, 5, "uses:") == 0) {
+      predicate.kind = SC3SearchPredicate::Uses;
+      predicate.var = parseVar(token.substr(5));
+    } else if (token.compare(0, 7, "writes:") == 0) {
+      predicate.kind = SC3SearchPredicate::Writes;
+      predicate.var = parseVar(token.substr(7));
+    } else {
+      size_t op = token.find_first_of("=:~");
+      if (op == std::string::npos || op == 0)
+        throw std::runtime_error("Not a predicate: " + token);
+      predicate.argName = token.substr(0, op);
+      std::string operand = token.substr(op + 1);
+      if (token[op] == '=') {
+        predicate.kind = SC3SearchPredicate::ArgEquals;
+        predicate.value = parseNumber(operand);
+      } else if (token[op] == ':') {
+        predicate.kind = SC3SearchPredicate::ArgType;
+        auto type = ArgTypeNames.find(operand);
+        if (type == ArgTypeNames.end())
+          throw std::runtime_error("Unknown argument type: " + operand);
+        predicate.argType = type->second;
+      } else {
+        predicate.kind = SC3SearchPredicate::ArgUses;
+        predicate.var = parseVar(operand);
+      }
+    }
+    query._predicates.push_back(predicate);
+  }
+  return query;
+}
+
+static bool argHasExpression(const SC3Argument& arg) {
+  return arg.type == Expression || arg.type == ExprFlagRef ||
+         arg.type == ExprGlobalVarRef || arg.type == ExprThreadVarRef ||
+         arg.type == FarLabel;
+}
+
+// index is -1 if it isn't constant
+static void forEachVarRef(
+    const SC3Argument& arg,
+    const std::function<void(SC3ExpressionTokenType, int)>& visitor) {
+  if (!argHasExpression(arg)) return;
+  const SC3ExpressionNode* root = arg.exprValue.simplified();
+  if (root != nullptr) {
+    root->traverse([&](const SC3ExpressionNode* node) {
+      if ((node->type == FuncGlobalVars || node->type == FuncFlags) &&
+          node->rhs != nullptr) {
+        visitor(node->type, node->rhs->type == ImmediateValue
+                                ? node->rhs->value
+                                : -1);
+      }
+    });
+  }
+  // the argument itself is a variable index
+  if (arg.type == ExprGlobalVarRef || arg.type == ExprFlagRef) {
+    SC3ExpressionTokenType space =
+        arg.type == ExprGlobalVarRef ? FuncGlobalVars : FuncFlags;
+    if (root == nullptr)
+      visitor(space, 0);
+    else
+      visitor(space, root->type == ImmediateValue ? root->value : -1);
+  }
+}
+
+static void forEachVarWrite(
+    const SC3Argument& arg,
+    const std::function<void(SC3ExpressionTokenType, int)>& visitor) {
+  if (!argHasExpression(arg)) return;
+  const SC3ExpressionNode* root = arg.exprValue.simplified();
+  if (root == nullptr) return;
+  root->traverse([&](const SC3ExpressionNode* node) {
+    bool assigns = (node->type >= Assign && node->type <= BitwiseXorAssign) ||
+                   node->type == Increment || node->type == Decrement;
+    if (!assigns || node->lhs == nullptr) return;
+    const SC3ExpressionNode* target = node->lhs.get();
+    if ((target->type == FuncGlobalVars || target->type == FuncFlags) &&
+        target->rhs != nullptr) {
+      visitor(target->type, target->rhs->type == ImmediateValue
+                                ? target->rhs->value
+                                : -1);
+    }
+  });
+}
+
+static bool varMatches(const SC3VarPattern& pattern,
+                       SC3ExpressionTokenType space, int index) {
+  return pattern.space == space &&
+         (pattern.index < 0 || pattern.index == index);
+}
+
+static bool argConstantValue(const SC3Argument& arg, int* value) {
+  switch (arg.type) {
+    case Byte:
+      *value = arg.byteValue;
+      return true;
+    case UInt16:
+    case LocalLabel:
+    case FarLabel:
+    case ReturnAddress:
+    case StringRef:
+      *value = arg.uint16_value;
+      return true;
+    case Expression:
+    case ExprFlagRef:
+    case ExprGlobalVarRef:
+    case ExprThreadVarRef: {
+      const SC3ExpressionNode* root = arg.exprValue.simplified();
+      if (root == nullptr) {
+        *value = 0;
+        return true;
+      }
+      if (root->type != ImmediateValue) return false;
+      *value = root->value;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+static bool predicateMatches(const SC3SearchPredicate& predicate,
+                             const SC3Instruction& inst) {
+  for (const auto& arg : inst.args()) {
+    switch (predicate.kind) {
+      case SC3SearchPredicate::ArgEquals: {
+        int value;
+        if (arg.name == predicate.argName && argConstantValue(arg, &value) &&
+            value == predicate.value)
+          return true;
+        break;
+      }
+      case SC3SearchPredicate::ArgType:
+        if (arg.name == predicate.argName && arg.type == predicate.argType)
+          return true;
+        break;
+      case SC3SearchPredicate::ArgUses:
+      case SC3SearchPredicate::Uses: {
+        if (predicate.kind == SC3SearchPredicate::ArgUses &&
+            arg.name != predicate.argName)
+          break;
+        bool found = false;
+        forEachVarRef(arg, [&](SC3ExpressionTokenType space, int index) {
+          if (varMatches(predicate.var, space, index)) found = true;
+        });
+        if (found) return true;
+        break;
+      }
+      case SC3SearchPredicate::Writes: {
+        bool found = false;
+        forEachVarWrite(arg, [&](SC3ExpressionTokenType space, int index) {
+          if (varMatches(predicate.var, space, index)) found = true;
+        });
+        if (found) return true;
+        break;
+      }
+    }
+  }
+  return false;
+}
+
+bool SC3InstructionQuery::matches(const SC3Instruction& inst) const {
+  if (!_opcode.empty() && inst.name() != _opcode) return false;
+  for (const auto& predicate : _predicates) {
+    if (!predicateMatches(predicate, inst)) return false;
+  }
+  return true;
+}
+
+SC3InstructionSearch::SC3InstructionSearch(
+    const std::vector<const SCXFile*>& files, int threadCount) {
+  if (threadCount <= 0) threadCount = std::thread::hardware_concurrency();
+  if (threadCount <= 0) threadCount = 1;
+  _threadCount = threadCount;
+
+  std::vector<uint32_t> fileStarts;
+  for (const SCXFile* file : files) {
+    fileStarts.push_back((uint32_t)_instructions.size());
+    for (const auto& label : file->disassembly()) {
+      for (const auto& inst : label->instructions())
+        _instructions.push_back({file->getId(), label->id(), inst.get()});
+    }
+  }
+  fileStarts.push_back((uint32_t)_instructions.size());
+
+  // per-file postings, merged in file order so they stay sorted
+  struct FilePostings {
+    std::unordered_map<std::string, std::vector<uint32_t>> byOpcode;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> byVariable;
+  };
+  std::vector<FilePostings> perFile(files.size());
+  ParallelFor(files.size(), _threadCount, [&](size_t f) {
+    FilePostings& postings = perFile[f];
+    for (uint32_t i = fileStarts[f]; i < fileStarts[f + 1]; i++) {
+      const SC3Instruction* inst = _instructions[i].inst;
+      postings.byOpcode[inst->name()].push_back(i);
+      for (const auto& arg : inst->args()) {
+        forEachVarRef(arg, [&](SC3ExpressionTokenType space, int index) {
+          if (index < 0) return;
+          auto& list = postings.byVariable[varKey(space, index)];
+          if (list.empty() || list.back() != i) list.push_back(i);
+        });
+      }
+    }
+  });
+  for (auto& postings : perFile) {
+    for (auto& entry : postings.byOpcode) {
+      auto& list = _byOpcode[entry.first];
+      list.insert(list.end(), entry.second.begin(), entry.second.end());
+    }
+    for (auto& entry : postings.byVariable) {
+      auto& list = _byVariable[entry.first];
+      list.insert(list.end(), entry.second.begin(), entry.second.end());
+    }
+  }
+}
+
+std::vector<SC3SearchHit> SC3InstructionSearch::find(
+    const SC3InstructionQuery& query) const {
+  std::vector<SC3SearchHit> result;
+
+  // smallest posting list any predicate narrows it down to, if any
+  static const std::vector<uint32_t> none;
+  const std::vector<uint32_t>* candidates = nullptr;
+  auto narrow = [&](const std::vector<uint32_t>* list) {
+    if (candidates == nullptr || list->size() < candidates->size())
+      candidates = list;
+  };
+  if (!query.opcode().empty()) {
+    auto it = _byOpcode.find(query.opcode());
+    narrow(it == _byOpcode.end() ? &none : &it->second);
+  }
+  for (const auto& predicate : query.predicates()) {
+    if (predicate.kind == SC3SearchPredicate::ArgType ||
+        predicate.kind == SC3SearchPredicate::ArgEquals ||
+        predicate.var.index < 0)
+      continue;
+    auto it =
+        _byVariable.find(varKey(predicate.var.space, predicate.var.index));
+    narrow(it == _byVariable.end() ? &none : &it->second);
+  }
+
+  size_t count = candidates ? candidates->size() : _instructions.size();
+  // chunks keep the results in order without sorting afterwards
+  static const size_t ChunkSize = 4096;
+  size_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+  std::vector<std::vector<SC3SearchHit>> chunks(chunkCount);
+  ParallelFor(chunkCount, _threadCount, [&](size_t chunk) {
+    size_t end = std::min(count, (chunk + 1) * ChunkSize);
+    for (size_t i = chunk * ChunkSize; i < end; i++) {
+      const Location& location =
+          _instructions[candidates ? (*candidates)[i] : i];
+      if (query.matches(*location.inst))
+        chunks[chunk].push_back(
+            {location.fileId, location.labelId, location.inst});
+    }
+  });
+  for (const auto& chunk : chunks)
+    result.insert(result.end(), chunk.begin(), chunk.end());
+  return result;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "SCXTypes.h"
+#include "SC3Argument.h"
+#include "SC3Expression.h"
+#include "SC3Instruction.h"
+
+class SCXFile;
+
+// GlobalVars[index] or Flags[index], index -1 matches any
+struct SC3VarPattern {
+  SC3ExpressionTokenType space;
+  int index;
+};
+
+struct SC3SearchPredicate {
+  enum Kind { ArgEquals, ArgType, ArgUses, Uses, Writes };
+  Kind kind;
+  // ArgEquals, ArgType, ArgUses
+  std::string argName;
+  // ArgEquals
+  int value;
+  // ArgType
+  SC3ArgumentType argType;
+  // ArgUses, Uses, Writes
+  SC3VarPattern var;
+};
+
+// A structural query over single instructions. All predicates must hold.
+//
+// Syntax: an instruction name (or * for any) followed by predicates:
+//   arg=N       argument arg is the constant N (byte/uint16 values, label and
+//               string ids, constant expressions)
+//   arg:Type    argument arg has the type, e.g. Expression, LocalLabel
+//   arg~Var     argument arg's expression references Var
+//   uses:Var    any argument references Var
+//   writes:Var  an expression assigns to (or increments/decrements) Var
+// Var is GlobalVars[N] or Flags[N], N can be * for any variable.
+//
+// e.g. "If condition~Flags[1234]", "BGMplay track=12",
+//      "Assign writes:GlobalVars[*]"
+class SC3InstructionQuery {
+ public:
+  // throws std::runtime_error on syntax errors
+  static SC3InstructionQuery parse(const std::string& text);
+
+  // empty for any
+  const std::string& opcode() const { return _opcode; }
+  const std::vector<SC3SearchPredicate>& predicates() const {
+    return _predicates;
+  }
+
+  bool matches(const SC3Instruction& inst) const;
+
+ private:
+  std::string _opcode;
+  std::vector<SC3SearchPredicate> _predicates;
+};
+
+struct SC3SearchHit {
+  int fileId;
+  int labelId;
+  const SC3Instruction* inst;
+};
+
+// Runs queries over the disassembly of a set of files. Instructions are
+// indexed by name and by the variables they reference, so queries naming an
+// instruction or a specific variable only check those candidates. Everything
+// else is a full scan split across threads. The files must outlive the search
+// and be disassembled before it's created.
+class SC3InstructionSearch {
+ public:
+  // threadCount 0 = one per core
+  explicit SC3InstructionSearch(const std::vector<const SCXFile*>& files,
+                                int threadCount = 0);
+
+  // in file, then address order
+  std::vector<SC3SearchHit> find(const SC3InstructionQuery& query) const;
+
+ private:
+  struct Location {
+    int fileId;
+    int labelId;
+    const SC3Instruction* inst;
+  };
+
+  int _threadCount;
+  // every instruction, in file and address order
+  std::vector<Location> _instructions;
+  // postings are indices into _instructions, ascending
+  std::unordered_map<std::string, std::vector<uint32_t>> _byOpcode;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> _byVariable;
+
+  static uint64_t varKey(SC3ExpressionTokenType space, int index) {
+    return ((uint64_t)(uint32_t)space << 32) | (uint32_t)index;
+  }
+};
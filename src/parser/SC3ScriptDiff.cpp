@@ -0,0 +1,223 @@
+#include "SC3ScriptDiff.h"
+#include <algorithm>
+#include <map>
+#include "ParallelFor.h"
+#include "SC3CodeBlock.h"
+#include "SCXFile.h"
+
+// beyond this many DP cells, changed regions are reported as replaced
+// wholesale instead of aligned
+static const size_t MaxLcsCells = 1 << 22;
+
+static uint64_t fnv1a(const std::string& data,
+                      uint64_t hash = 0xcbf29ce484222325ULL) {
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static uint64_t fnv1a(uint64_t value, uint64_t hash) {
+  for (int i = 0; i < 8; i++) {
+    hash ^= (value >> (i * 8)) & 0xFF;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+std::string NormalizedSC3Instruction(const SC3Instruction* inst) {
+  std::string result = inst->name();
+  for (const auto& arg : inst->args()) {
+    result += "|" + arg.name + ":";
+    switch (arg.type) {
+      case ByteArray:
+        result.append(arg.byteArrayValue.begin(), arg.byteArrayValue.end());
+        break;
+      case Byte:
+        result += std::to_string(arg.byteValue);
+        break;
+      case UInt16:
+      case LocalLabel:
+        result += std::to_string(arg.uint16_value);
+        break;
+      case FarLabel:
+        result += arg.exprValue.toString(true) + "," +
+                  std::to_string(arg.uint16_value);
+        break;
+      case Expression:
+      case ExprFlagRef:
+      case ExprGlobalVarRef:
+      case ExprThreadVarRef:
+        result += arg.exprValue.toString(true);
+        break;
+      case ReturnAddress:
+      case StringRef:
+        // ids into tables that get renumbered whenever anything is added
+        break;
+    }
+  }
+  return result;
+}
+
+// Aligns a with b: (i, j) pairs in order, i or j -1 for elements only in b or
+// a.
+static std::vector<std::pair<int, int>> align(const std::vector<uint64_t>& a,
+                                              const std::vector<uint64_t>& b) {
+  std::vector<std::pair<int, int>> result;
+  int n = (int)a.size(), m = (int)b.size();
+  int prefix = 0;
+  while (prefix < n && prefix < m && a[prefix] == b[prefix]) prefix++;
+  int suffix = 0;
+  while (suffix < n - prefix && suffix < m - prefix &&
+         a[n - 1 - suffix] == b[m - 1 - suffix])
+    suffix++;
+
+  for (int i = 0; i < prefix; i++) result.emplace_back(i, i);
+
+  int rows = n - prefix - suffix, cols = m - prefix - suffix;
+  if ((size_t)rows * cols > MaxLcsCells) {
+    for (int i = 0; i < rows; i++) result.emplace_back(prefix + i, -1);
+    for (int j = 0; j < cols; j++) result.emplace_back(-1, prefix + j);
+  } else if (rows > 0 || cols > 0) {
+    // lcs[i][j] = LCS length of the middle parts from i, j onwards. Fits in
+    // 16 bits because min(rows, cols) <= sqrt(MaxLcsCells)
+    std::vector<uint16_t> lcs((size_t)(rows + 1) * (cols + 1), 0);
+    auto at = [&](int i, int j) -> uint16_t& {
+      return lcs[(size_t)i * (cols + 1) + j];
+    };
+    for (int i = rows - 1; i >= 0; i--) {
+      for (int j = cols - 1; j >= 0; j--) {
+        if (a[prefix + i] == b[prefix + j])
+          at(i, j) = at(i + 1, j + 1) + 1;
+        else
+          at(i, j) = std::max(at(i + 1, j), at(i, j + 1));
+      }
+    }
+    int i = 0, j = 0;
+    while (i < rows || j < cols) {
+      if (i < rows && j < cols && a[prefix + i] == b[prefix + j]) {
+        result.emplace_back(prefix + i++, prefix + j++);
+      } else if (j < cols && (i == rows || at(i, j + 1) >= at(i + 1, j))) {
+        result.emplace_back(-1, prefix + j++);
+      } else {
+        result.emplace_back(prefix + i++, -1);
+      }
+    }
+  }
+
+  for (int i = 0; i < suffix; i++)
+    result.emplace_back(n - suffix + i, m - suffix + i);
+  return result;
+}
+
+struct HashedFile {
+  // per label
+  std::vector<std::vector<uint64_t>> instructionHashes;
+  std::vector<uint64_t> labelHashes;
+};
+
+static HashedFile hashFile(const SCXFile* file) {
+  HashedFile result;
+  if (file == nullptr) return result;
+  for (const auto& label : file->disassembly()) {
+    std::vector<uint64_t> hashes;
+    uint64_t labelHash = 0xcbf29ce484222325ULL;
+    for (const auto& inst : label->instructions()) {
+      uint64_t hash = fnv1a(NormalizedSC3Instruction(inst.get()));
+      hashes.push_back(hash);
+      labelHash = fnv1a(hash, labelHash);
+    }
+    result.instructionHashes.push_back(std::move(hashes));
+    result.labelHashes.push_back(labelHash);
+  }
+  return result;
+}
+
+static SC3LabelDiff diffLabels(const SCXFile* oldFile,
+                               const HashedFile& oldHashes, int oldLabelId,
+                               const SCXFile* newFile,
+                               const HashedFile& newHashes, int newLabelId) {
+  SC3LabelDiff result;
+  result.kind = SC3LabelDiff::Changed;
+  result.oldLabelId = oldLabelId;
+  result.newLabelId = newLabelId;
+  const auto& oldInsts = oldFile->disassembly()[oldLabelId]->instructions();
+  const auto& newInsts = newFile->disassembly()[newLabelId]->instructions();
+  for (const auto& op : align(oldHashes.instructionHashes[oldLabelId],
+                              newHashes.instructionHashes[newLabelId])) {
+    SC3InstructionDiffOp diffOp;
+    diffOp.oldInst = op.first >= 0 ? oldInsts[op.first].get() : nullptr;
+    diffOp.newInst = op.second >= 0 ? newInsts[op.second].get() : nullptr;
+    if (op.first < 0)
+      diffOp.kind = SC3InstructionDiffOp::Added;
+    else if (op.second < 0)
+      diffOp.kind = SC3InstructionDiffOp::Removed;
+    else
+      diffOp.kind = SC3InstructionDiffOp::Same;
+    result.ops.push_back(diffOp);
+  }
+  return result;
+}
+
+bool SC3ScriptDiff::identical() const {
+  for (const auto& label : labels) {
+    if (label.kind != SC3LabelDiff::Unchanged) return false;
+  }
+  return true;
+}
+
+SC3ScriptDiff DiffSCXFiles(const SCXFile* oldFile, const SCXFile* newFile) {
+  SC3ScriptDiff result;
+  result.oldFile = oldFile;
+  result.newFile = newFile;
+  HashedFile oldHashes = hashFile(oldFile);
+  HashedFile newHashes = hashFile(newFile);
+
+  // labels that didn't match between two matched ones are paired up in order
+  // as changed, whatever's left over was removed or added
+  std::vector<int> removed, added;
+  auto flush = [&]() {
+    size_t paired = std::min(removed.size(), added.size());
+    for (size_t i = 0; i < paired; i++) {
+      result.labels.push_back(diffLabels(oldFile, oldHashes, removed[i],
+                                         newFile, newHashes, added[i]));
+    }
+    for (size_t i = paired; i < removed.size(); i++)
+      result.labels.push_back({SC3LabelDiff::Removed, removed[i], -1, {}});
+    for (size_t i = paired; i < added.size(); i++)
+      result.labels.push_back({SC3LabelDiff::Added, -1, added[i], {}});
+    removed.clear();
+    added.clear();
+  };
+
+  for (const auto& op : align(oldHashes.labelHashes, newHashes.labelHashes)) {
+    if (op.first < 0) {
+      added.push_back(op.second);
+    } else if (op.second < 0) {
+      removed.push_back(op.first);
+    } else {
+      flush();
+      result.labels.push_back(
+          {SC3LabelDiff::Unchanged, op.first, op.second, {}});
+    }
+  }
+  flush();
+  return result;
+}
+
+std::vector<SC3ScriptDiff> DiffSCXFileSets(
+    const std::vector<const SCXFile*>& oldFiles,
+    const std::vector<const SCXFile*>& newFiles, int threadCount) {
+  std::map<std::string, std::pair<const SCXFile*, const SCXFile*>> byName;
+  for (const SCXFile* file : oldFiles) byName[file->getName()].first = file;
+  for (const SCXFile* file : newFiles) byName[file->getName()].second = file;
+  std::vector<std::pair<const SCXFile*, const SCXFile*>> pairs;
+  for (const auto& entry : byName) pairs.push_back(entry.second);
+
+  std::vector<SC3ScriptDiff> result(pairs.size());
+  ParallelFor(pairs.size(), threadCount, [&](size_t i) {
+    result[i] = DiffSCXFiles(pairs[i].first, pairs[i].second);
+  });
+  return result;
+}
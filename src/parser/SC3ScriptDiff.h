@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SC3Instruction.h"
+
+class SCXFile;
+
+struct SC3InstructionDiffOp {
+  enum Kind { Same, Removed, Added };
+  Kind kind;
+  // nullptr for Added
+  const SC3Instruction* oldInst;
+  // nullptr for Removed
+  const SC3Instruction* newInst;
+};
+
+struct SC3LabelDiff {
+  enum Kind { Unchanged, Changed, Removed, Added };
+  Kind kind;
+  // -1 for Added
+  int oldLabelId;
+  // -1 for Removed
+  int newLabelId;
+  // only filled in for Changed labels
+  std::vector<SC3InstructionDiffOp> ops;
+};
+
+struct SC3ScriptDiff {
+  // either may be nullptr if the script only exists on one side
+  const SCXFile* oldFile;
+  const SCXFile* newFile;
+  // in label order of both files
+  std::vector<SC3LabelDiff> labels;
+
+  bool identical() const;
+};
+
+// Label-level diff of two disassembled scripts. Every label is reduced to a
+// hash of its normalized instructions (string and return address ids, which
+// shift around between builds, are left out), labels are matched by LCS over
+// those hashes, and only labels that didn't match get an instruction diff.
+SC3ScriptDiff DiffSCXFiles(const SCXFile* oldFile, const SCXFile* newFile);
+
+// Diffs scripts with the same name in both sets, threadCount 0 = one per core.
+// Scripts only in one set come out as all labels Removed/Added. Ordered by
+// name.
+std::vector<SC3ScriptDiff> DiffSCXFileSets(
+    const std::vector<const SCXFile*>& oldFiles,
+    const std::vector<const SCXFile*>& newFiles, int threadCount = 0);
+
+// what gets hashed for an instruction
+std::string NormalizedSC3Instruction(const SC3Instruction* inst);
@@ -7,6 +7,13 @@ SCXFile::SCXFile(uint8_t *data, SCXOffset length, const std::string &name,
   parseHeader();
 }
 
+SCXFile::SCXFile(uint8_t *data, SCXOffset length, const std::string &name,
+                 int id, std::shared_ptr<void> owner)
+    : _data(data), _owner(std::move(owner)), _length(length), _name(name),
+      _id(id) {
+  parseHeader();
+}
+
 SCXOffset SCXFile::getStringOffset(const SCXTableIndex stringId) const {
   return _stringTable[stringId];
 }
@@ -20,10 +27,15 @@ SCXOffset SCXFile::getLabelOffset(const SCXTableIndex labelId) const {
   return _labelTable[labelId];
 }
 
-SCXFile::~SCXFile() { free(_data); }
+SCXFile::~SCXFile() {
+  if (_owner == nullptr) free(_data);
+}
 
 void SCXFile::appendLabel(SC3CodeBlock *label) {
   _disassembly.push_back(std::unique_ptr<SC3CodeBlock>(label));
+  for (const auto &inst : label->instructions())
+    _instructionOffsets.push_back(inst->position());
+  _labelInstructionStarts.push_back((uint32_t)_instructionOffsets.size());
 }
 
 void SCXFile::parseHeader() {
@@ -2,12 +2,17 @@
 #include <cstdint>
 #include <vector>
 #include <memory>
+#include <string>
 #include "SCXTypes.h"
 #include "SC3CodeBlock.h"
 
 class SCXFile {
  public:
+  // takes ownership of malloc'd data
   SCXFile(uint8_t* data, SCXOffset length, const std::string& name, int id);
+  // data stays owned by (and alive with) owner, e.g. a file mapping
+  SCXFile(uint8_t* data, SCXOffset length, const std::string& name, int id,
+          std::shared_ptr<void> owner);
   const std::string& getName() const { return _name; }
   int getId() const { return _id; }
   SCXOffset getStringOffset(const SCXTableIndex stringId) const;
@@ -28,9 +33,19 @@ class SCXFile {
   const std::vector<std::unique_ptr<SC3CodeBlock>>& disassembly() const {
     return _disassembly;
   }
+  // Start offsets of every disassembled instruction, in label order (which is
+  // address order), and the index of each label's first instruction in it,
+  // plus the total count at the end. For binary searching addresses.
+  const std::vector<SCXOffset>& instructionOffsets() const {
+    return _instructionOffsets;
+  }
+  const std::vector<uint32_t>& labelInstructionStarts() const {
+    return _labelInstructionStarts;
+  }
 
  private:
   uint8_t* _data;
+  std::shared_ptr<void> _owner;
   SCXOffset _length;
   const std::string _name;
   const int _id;
@@ -51,4 +66,6 @@ class SCXFile {
       SCXReturnAddressTableOffsetOffset + sizeof(SCXOffset);
 
   std::vector<std::unique_ptr<SC3CodeBlock>> _disassembly;
+  std::vector<SCXOffset> _instructionOffsets;
+  std::vector<uint32_t> _labelInstructionStarts{0};
 };
\ No newline at end of file
@@ -8,6 +8,10 @@ SC3StringDecoder* SupportedGame::createStringDecoder(SCXFile& file) const {
   return new SC3StringDecoder(file, charset());
 }
 
+// the limit the project has always assumed for every game
+int SupportedGame::globalVarCount() const { return 8000; }
+int SupportedGame::flagCount() const { return 8000; }
+
 SC3BaseDisassembler* CCGame::createDisassembler(SCXFile& file) const {
   return new CCDisassembler(file);
 }
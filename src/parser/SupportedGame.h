@@ -13,6 +13,9 @@ class SupportedGame {
   virtual int id() const = 0;
   virtual const std::string name() const = 0;
   virtual const std::vector<std::string> &charset() const = 0;
+  // size of the GlobalVars/Flags spaces
+  virtual int globalVarCount() const;
+  virtual int flagCount() const;
 };
 
 class CCGame : public SupportedGame {